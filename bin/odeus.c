@@ -7,36 +7,54 @@
 #include <readline/readline.h>
 
 #include "builtins/set_builtins.h"
+#include "builtins/stdio.h"
+#include "core/code_cache.h"
 #include "core/environment.h"
 #include "core/eval.h"
+#include "core/expand.h"
+#include "core/image.h"
 #include "core/lexer.h"
-#include "core/parser.h"
+#include "core/mapped_file.h"
+#include "core/meta_map.h"
+#include "core/node.h"
+#include "core/reader.h"
 #include "core/symbol_map.h"
 #include "core/value.h"
-
-char *
-read_file_to_string (const char *filename)
+#include "core/vm.h"
+
+#ifdef ODEUS_PRELUDE_IMAGE
+// stdio/prelude.ode, run at build time and saved as a heap image (see
+// CMakeLists.txt)
+extern const unsigned char prelude_image[];
+extern const size_t prelude_image_size;
+#endif
+
+// Evaluate the forms of filename in environment, false (after saying why)
+// if the file cannot be read or a form fails
+static bool
+run_file (Environment *environment, char *filename,
+          Value *(*evaluate) (Environment *, Value *))
 {
-  FILE *f = fopen (filename, "rb");
-  if (!f)
-    return NULL;
+  MappedFile file;
+  if (!mapped_file_open (filename, &file))
+    {
+      fprintf (stderr, "Failed to open file: %s\n", filename);
+      return false;
+    }
+
+  Lexer lexer = lexer_from_file (filename, file.data, file.size);
+  Reader reader = reader_init (&lexer);
 
-  fseek (f, 0, SEEK_END);
-  long size = ftell (f);
-  fseek (f, 0, SEEK_SET);
+  Value *result = evaluate_expanded (environment, &reader, evaluate);
+  mapped_file_close (&file);
 
-  char *buffer = GC_malloc (size + 1);
-  if (!buffer)
+  if (TYPE (result) == VALUE_ERROR)
     {
-      fclose (f);
-      return NULL;
+      fprintf (stderr, "%s: %s\n", filename, AS_ERROR (result)->MESSAGE);
+      return false;
     }
 
-  fread (buffer, 1, size, f);
-  buffer[size] = '\0';
-  fclose (f);
-
-  return buffer;
+  return true;
 }
 
 int
@@ -45,28 +63,92 @@ main (int argc, char **argv)
   GC_INIT ();
   GC_enable_incremental ();
 
+  // --vm and --nodes run programs on the bytecode VM or the closure
+  // compiler instead of the tree-walker. --image starts from a heap image
+  // instead of the builtins and the prelude, --no-prelude from the bare
+  // builtins. --dump-image saves one after running all the files given (see
+  // image.h). --no-code-cache neither uses nor writes .odec files.
+  Value *(*evaluate) (Environment *, Value *) = evaluate_expression;
+  const char *image = NULL;
+  const char *dump_image = NULL;
+  bool prelude = true;
+
+  int arg = 1;
+  for (; arg < argc; arg++)
+    {
+      if (strcmp (argv[arg], "--vm") == 0)
+        evaluate = vm_evaluate;
+      else if (strcmp (argv[arg], "--nodes") == 0)
+        evaluate = node_evaluate;
+      else if (strcmp (argv[arg], "--image") == 0 && arg + 1 < argc)
+        image = argv[++arg];
+      else if (strcmp (argv[arg], "--dump-image") == 0 && arg + 1 < argc)
+        dump_image = argv[++arg];
+      else if (strcmp (argv[arg], "--no-prelude") == 0)
+        prelude = false;
+      else if (strcmp (argv[arg], "--no-code-cache") == 0)
+        code_cache_enabled = false;
+      else
+        break;
+    }
+
+  load_file_evaluate = evaluate;
+
+  meta_map_init ();
   symbol_map_init();
   // Persistent global environment
-  Environment *global_env = env_init (NULL);
-  set_builtins (global_env);
-
-  if (argc > 1)
+  Environment *global_env;
+  Value *error = NULL;
+#ifndef ODEUS_PRELUDE_IMAGE
+  (void)prelude; // odeus-bootstrap has none to load
+#endif
+  if (image)
+    error = image_load (image, set_builtins, &global_env);
+#ifdef ODEUS_PRELUDE_IMAGE
+  else if (prelude)
     {
-      char *filename = argv[1];
-      char *file_content = read_file_to_string (filename);
-      if (!file_content)
+      error = image_load_bytes (prelude_image, prelude_image_size, "prelude",
+                                set_builtins, &global_env);
+
+      // programs may define the prelude's names again, for versions of their
+      // own or by loading a copy of the prelude themselves
+      if (TYPE (error) != VALUE_ERROR)
         {
-          fprintf (stderr, "Failed to open file: %s\n", filename);
-          return 1;
+          Environment *builtins = env_init (NULL);
+          set_builtins (builtins);
+          env_mark_redefinable (global_env, builtins);
         }
+    }
+#endif
+  else
+    {
+      global_env = env_init (NULL);
+      set_builtins (global_env);
+    }
 
-      Lexer lexer
-          = lexer_from_file (filename, file_content, strlen (file_content));
-      Parser *parser = parser_init (&lexer);
-      AST *program = parser_parse (parser);
-      Value *lower = val_from_ast (program);
+  if (error && TYPE (error) == VALUE_ERROR)
+    {
+      fprintf (stderr, "%s\n", AS_ERROR (error)->MESSAGE);
+      return 1;
+    }
 
-      evaluate_expression (global_env, lower);
+  if (dump_image)
+    {
+      for (; arg < argc; arg++)
+        if (!run_file (global_env, argv[arg], evaluate))
+          return 1;
+
+      error = image_dump (global_env, dump_image, set_builtins);
+      if (TYPE (error) == VALUE_ERROR)
+        {
+          fprintf (stderr, "%s\n", AS_ERROR (error)->MESSAGE);
+          return 1;
+        }
+    }
+  else if (arg < argc)
+    {
+      if (!run_file (global_env, argv[arg], evaluate))
+        return 1;
     }
   else
     {
@@ -88,11 +170,10 @@ main (int argc, char **argv)
             add_history (input);
 
           Lexer lexer = lexer_from_string (input, strlen (input));
-          Parser *parser = parser_init (&lexer);
-          AST *program = parser_parse (parser);
-          Value *lower = val_from_ast (program);
+          Reader reader = reader_init (&lexer);
+          Value *program = reader_read_program (&reader);
 
-          result = evaluate_expression (global_env, lower);
+          result = evaluate (global_env, program);
           printf ("-> ");
           value_print (result);
           printf ("\n");
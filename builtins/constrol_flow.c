@@ -4,23 +4,21 @@
 #include "core/value.h"
 
 Value *
-builtin_eq (Environment *environment, Value *arguments)
+builtin_eq (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 2)
-    return val_error ("eq: expects exactly two arguments");
+  (void)argc;
 
-  Value *first = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (first);
-  Value *second = evaluate_expression (environment, CADR (arguments));
-  ERROR_OUT (second);
+  Value *first = argv[0];
+  Value *second = argv[1];
 
-  if (first->type != second->type)
+  if (TYPE (first) != TYPE (second))
     return val_nil ();
 
-  switch (first->type)
+  switch (TYPE (first))
     {
     case VALUE_NIL:
     case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
     case VALUE_SYMBOL:
       return (first == second) ? val_t () : val_nil ();
     default:
@@ -41,21 +39,24 @@ builtin_if (Environment *environment, Value *args)
   ERROR_OUT (cond);
 
   if (!IS_NULL (cond))
-    return evaluate_expression (environment, CADR (args));
+    return eval_tail_call (environment, CADR (args));
   else
-    return evaluate_expression (environment, CADR (CDR (args)));
+    return eval_tail_call (environment, CADR (CDR (args)));
 }
 
+// and/or evaluate their last argument in tail position, so they return its
+// value rather than t
 Value *
 builtin_and (Environment *environment, Value *arguments)
 {
   if (arguments_length (arguments) <= 0)
     return val_error ("ERROR: and expects at levalue 1 argument\n");
 
-  while (arguments->type == VALUE_CONS)
+  while (TYPE (CDR (arguments)) == VALUE_CONS)
     {
       Value *current_condition
           = evaluate_expression (environment, CAR (arguments));
+      ERROR_OUT (current_condition);
 
       if (IS_NULL (current_condition))
         return val_nil ();
@@ -63,7 +64,7 @@ builtin_and (Environment *environment, Value *arguments)
       arguments = CDR (arguments);
     }
 
-  return val_t ();
+  return eval_tail_call (environment, CAR (arguments));
 }
 
 Value *
@@ -72,16 +73,17 @@ builtin_or (Environment *environment, Value *arguments)
   if (arguments_length (arguments) <= 0)
     return val_error ("ERROR: or expects at levalue 1 argument\n");
 
-  while (arguments->type == VALUE_CONS)
+  while (TYPE (CDR (arguments)) == VALUE_CONS)
     {
       Value *current_condition
           = evaluate_expression (environment, CAR (arguments));
+      ERROR_OUT (current_condition);
 
       if (!IS_NULL (current_condition))
-        return val_t ();
+        return current_condition;
 
       arguments = CDR (arguments);
     }
 
-  return val_nil ();
+  return eval_tail_call (environment, CAR (arguments));
 }
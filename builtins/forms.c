@@ -2,7 +2,9 @@
 
 #include "core/environment.h"
 #include "core/eval.h"
+#include "core/expand.h"
 #include "core/quasiquote.h"
+#include "core/resolve.h"
 #include "core/value.h"
 
 #include <gc.h>
@@ -17,48 +19,50 @@ builtin_define (Environment *environment, Value *arguments)
   Value *definition = CADR (arguments);
 
   // Case 1: Variable definition (define symbol expr)
-  if (to_be_defined->type == VALUE_SYMBOL)
+  if (TYPE (to_be_defined) == VALUE_SYMBOL)
     {
-      Value *current = env_get (environment, to_be_defined);
-      if (current->type != VALUE_ERROR)
-        return val_error ("define: symbol already defined: %s", to_be_defined->as.SYMBOL);
+      if (env_is_defined (environment, to_be_defined))
+        return val_error ("define: symbol already defined: %s",
+                          AS_SYMBOL (to_be_defined)->name);
 
       // Initialize with nil first
-      env_set (environment, to_be_defined, val_nil (), to_be_defined->meta);
+      env_set (environment, to_be_defined, val_nil (),
+               value_meta (to_be_defined));
 
       Value *value = evaluate_expression (environment, definition);
       ERROR_OUT (value);
 
       // Update the binding
-      env_update (environment, to_be_defined, value, to_be_defined->meta);
+      env_update (environment, to_be_defined, value,
+                  value_meta (to_be_defined));
 
       return to_be_defined;
     }
   // Case 2: Function definition (define (name args...) expr)
-  else if (to_be_defined->type == VALUE_CONS)
+  else if (TYPE (to_be_defined) == VALUE_CONS)
     {
       if (IS_NULL (to_be_defined))
         return val_error ("define: function definition cannot be empty");
 
       Value *func_name = CAR (to_be_defined);
-      if (func_name->type != VALUE_SYMBOL)
+      if (TYPE (func_name) != VALUE_SYMBOL)
         return val_error ("define: function name must be a symbol");
 
-      Value *current = env_get (environment, func_name);
-      if (current->type != VALUE_ERROR)
-        return val_error ("define: symbol already defined: %s", func_name->as.SYMBOL);
+      if (env_is_defined (environment, func_name))
+        return val_error ("define: symbol already defined: %s",
+                          AS_SYMBOL (func_name)->name);
 
       Value *params = CDR (to_be_defined);
 
       // Initialize with nil first
-      env_set (environment, func_name, val_nil (), func_name->meta);
+      env_set (environment, func_name, val_nil (), value_meta (func_name));
 
       Value *lambda_args = val_cons (params, CDR (arguments));
       Value *lambda = builtin_lambda (environment, lambda_args);
       ERROR_OUT (lambda);
 
       // Update the environment with the lambda
-      env_update (environment, func_name, lambda, func_name->meta);
+      env_update (environment, func_name, lambda, value_meta (func_name));
 
       return func_name;
     }
@@ -73,17 +77,17 @@ builtin_set (Environment *environment, Value *arguments)
     return val_error ("set!: expects (symbol expr)");
 
   Value *symbol = CAR (arguments);
-  if (symbol->type != VALUE_SYMBOL)
+  if (TYPE (symbol) != VALUE_SYMBOL)
     return val_error ("set!: first argument must be a symbol");
 
   Value *current = env_get (environment, symbol);
-  if (current->type == VALUE_ERROR)
+  if (TYPE (current) == VALUE_ERROR)
     return val_error ("set!: cannot set! undefined symbol");
 
   Value *value = evaluate_expression (environment, CADR (arguments));
   ERROR_OUT (value);
 
-  env_update (environment, symbol, value, symbol->meta);
+  env_update (environment, symbol, value, value_meta (symbol));
 
   return symbol;
 }
@@ -97,48 +101,39 @@ builtin_let (Environment *environment, Value *arguments)
   Value *bindings = CAR (arguments);
   Value *body = CDR (arguments);
 
-  if (bindings->type != VALUE_CONS && bindings->type != VALUE_NIL)
+  if (TYPE (bindings) != VALUE_CONS && TYPE (bindings) != VALUE_NIL)
     return val_error ("let: first argument must be a list of bindings");
 
   Environment *inner_environment = environment;
 
   Value *current = bindings;
-  while (current->type == VALUE_CONS)
+  while (TYPE (current) == VALUE_CONS)
     {
       Value *binding = CAR (current);
-      if (binding->type != VALUE_CONS || IS_NULL (binding)
+      if (TYPE (binding) != VALUE_CONS || IS_NULL (binding)
           || IS_NULL (CDR (binding)))
         return val_error ("let: each binding must be (symbol value)");
 
       Value *key = CAR (binding);
       Value *value_expression = CADR (binding);
 
-      if (key->type != VALUE_SYMBOL)
+      if (TYPE (key) != VALUE_SYMBOL)
         return val_error ("let: binding first element must be symbol");
 
       // Initialize with nil first
-      env_set (inner_environment, key, val_nil (), key->meta);
+      env_set (inner_environment, key, val_nil (), value_meta (key));
 
       // Evaluate value in parent environment
       Value *value = evaluate_expression (environment, value_expression);
       ERROR_OUT (value);
 
       // Update binding
-      env_update (inner_environment, key, value, key->meta);
+      env_update (inner_environment, key, value, value_meta (key));
 
       current = CDR (current);
     }
 
-  Value *result = val_nil ();
-  current = body;
-  while (current->type == VALUE_CONS)
-    {
-      result = evaluate_expression (inner_environment, CAR (current));
-      ERROR_OUT (result);
-      current = CDR (current);
-    }
-
-  return result;
+  return builtin_begin (inner_environment, body);
 }
 
 Value *
@@ -150,60 +145,52 @@ builtin_let_star (Environment *environment, Value *arguments)
   Value *bindings = CAR (arguments);
   Value *body = CDR (arguments);
 
-  if (bindings->type != VALUE_CONS && bindings->type != VALUE_NIL)
+  if (TYPE (bindings) != VALUE_CONS && TYPE (bindings) != VALUE_NIL)
     return val_error ("let*: first argument must be a list of bindings");
 
   Environment *inner_environment = environment;
 
   Value *current = bindings;
-  while (current->type == VALUE_CONS)
+  while (TYPE (current) == VALUE_CONS)
     {
       Value *binding = CAR (current);
-      if (binding->type != VALUE_CONS || IS_NULL (binding)
+      if (TYPE (binding) != VALUE_CONS || IS_NULL (binding)
           || IS_NULL (CDR (binding)))
         return val_error ("let: each binding must be (symbol value)");
 
       Value *key = CAR (binding);
       Value *value_expression = CADR (binding);
 
-      if (key->type != VALUE_SYMBOL)
+      if (TYPE (key) != VALUE_SYMBOL)
         return val_error ("let: binding first element must be symbol");
 
-      env_set (inner_environment, key, val_nil (), key->meta);
+      env_set (inner_environment, key, val_nil (), value_meta (key));
 
       Value *value = evaluate_expression (inner_environment, value_expression);
       ERROR_OUT (value);
 
-      env_update (inner_environment, key, value, key->meta);
+      env_update (inner_environment, key, value, value_meta (key));
 
       current = CDR (current);
     }
 
-  Value *result = val_nil ();
-  current = body;
-  while (current->type == VALUE_CONS)
-    {
-      result = evaluate_expression (inner_environment, CAR (current));
-      ERROR_OUT (result);
-      current = CDR (current);
-    }
-
-  return result;
+  return builtin_begin (inner_environment, body);
 }
 
 Value *
 builtin_begin (Environment *environment, Value *arguments)
 {
-  Value *lvalue = val_nil ();
+  if (TYPE (arguments) != VALUE_CONS)
+    return val_nil ();
 
-  while (arguments->type == VALUE_CONS)
+  while (TYPE (CDR (arguments)) == VALUE_CONS)
     {
-      lvalue = evaluate_expression (environment, CAR (arguments));
+      Value *lvalue = evaluate_expression (environment, CAR (arguments));
       ERROR_OUT (lvalue);
       arguments = CDR (arguments);
     }
 
-  return lvalue;
+  return eval_tail_call (environment, CAR (arguments));
 }
 
 Value *
@@ -217,7 +204,8 @@ builtin_eval (Environment *env, Value *args)
   Value *expr_to_eval = evaluate_expression (env, expr);
   ERROR_OUT (expr_to_eval);
 
-  return evaluate_expression (env, expr_to_eval);
+  // run as code of its own (see val_code), the data stays as it is
+  return eval_tail_call (env, macro_expand_all (env, expr_to_eval));
 }
 
 Value *
@@ -240,7 +228,7 @@ builtin_quasiquote (Environment *environment, Value *arguments)
   Value *expansion_logic = expand_quasiquote (CAR (arguments), 1);
   ERROR_OUT (expansion_logic);
 
-  return evaluate_expression (environment, expansion_logic);
+  return eval_tail_call (environment, expansion_logic);
 }
 
 Value *
@@ -252,11 +240,13 @@ builtin_lambda (Environment *environment, Value *arguments)
   Value *parameters = CAR (arguments);
   Value *body = CDR (arguments);
 
-  Value *lambda = GC_malloc (sizeof (Value));
+  body = resolve_lambda (environment, parameters, body);
+
+  Value *lambda = GC_malloc (sizeof (ClosureValue));
   lambda->type = VALUE_LAMBDA;
-  lambda->as.CLOSURE.parameters = parameters;
-  lambda->as.CLOSURE.body = body;
-  lambda->as.CLOSURE.environment = environment;
+  AS_CLOSURE (lambda)->parameters = parameters;
+  AS_CLOSURE (lambda)->body = body;
+  AS_CLOSURE (lambda)->environment = environment;
 
   return lambda;
 }
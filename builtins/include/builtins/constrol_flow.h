@@ -4,7 +4,7 @@
 #include "core/value.h"
 #include "core/eval.h"
 
-Value *builtin_eq (Environment *environment, Value *arguments);
+Value *builtin_eq (size_t argc, Value **argv);
 Value *builtin_if (Environment *environment, Value *arguments);
 Value *builtin_and (Environment *environment, Value *arguments);
 Value *builtin_or (Environment *environment, Value *arguments);
@@ -4,15 +4,15 @@
 #include "core/value.h"
 #include "core/eval.h"
 
-Value *builtin_cons (Environment *environment, Value *arguments);
-Value *builtin_list (Environment *environment, Value *arguments);
+Value *builtin_cons (size_t argc, Value **argv);
+Value *builtin_list (size_t argc, Value **argv);
 
-Value *builtin_car (Environment *environment, Value *arguments);
-Value *builtin_cdr (Environment *environment, Value *arguments);
-Value *builtin_set_car (Environment *environment, Value *arguments);
-Value *builtin_set_cdr (Environment *environment, Value *arguments);
-Value *builtin_length (Environment *environment, Value *arguments);
-Value *builtin_reverse (Environment *environment, Value *arguments);
+Value *builtin_car (size_t argc, Value **argv);
+Value *builtin_cdr (size_t argc, Value **argv);
+Value *builtin_set_car (size_t argc, Value **argv);
+Value *builtin_set_cdr (size_t argc, Value **argv);
+Value *builtin_length (size_t argc, Value **argv);
+Value *builtin_reverse (size_t argc, Value **argv);
 Value *builtin_filter (Environment *environment, Value *arguments);
 Value *builtin_apply (Environment *environment, Value *arguments);
 
@@ -7,25 +7,35 @@
 #include "core/eval.h"
 
 // Essentials
-Value *builtin_add (Environment *environment, Value *arguments);
-Value *builtin_sub (Environment *environment, Value *arguments);
-Value *builtin_mul (Environment *environment, Value *arguments);
-Value *builtin_div (Environment *environment, Value *arguments);
+Value *builtin_add (size_t argc, Value **argv);
+Value *builtin_sub (size_t argc, Value **argv);
+Value *builtin_mul (size_t argc, Value **argv);
+Value *builtin_div (size_t argc, Value **argv);
 
 // More math
-Value *builtin_mod (Environment *environment, Value *arguments);
-Value *builtin_expt (Environment *environment, Value *arguments);
-Value *builtin_sqrt (Environment *environment, Value *arguments);
-Value *builtin_abs (Environment *environment, Value *arguments);
-Value *builtin_floor (Environment *environment, Value *arguments);
-Value *builtin_ceil (Environment *environment, Value *arguments);
-Value *builtin_round (Environment *environment, Value *arguments);
+Value *builtin_mod (size_t argc, Value **argv);
+Value *builtin_expt (size_t argc, Value **argv);
+Value *builtin_sqrt (size_t argc, Value **argv);
+Value *builtin_abs (size_t argc, Value **argv);
+Value *builtin_floor (size_t argc, Value **argv);
+Value *builtin_ceil (size_t argc, Value **argv);
+Value *builtin_round (size_t argc, Value **argv);
 
 // Numeric comparison
-Value *builtin_num_eq (Environment *environment, Value *arguments);
-Value *builtin_num_gt (Environment *environment, Value *arguments);
-Value *builtin_num_lt (Environment *environment, Value *arguments);
-Value *builtin_num_gte (Environment *environment, Value *arguments);
-Value *builtin_num_lte (Environment *environment, Value *arguments);
+Value *builtin_num_eq (size_t argc, Value **argv);
+Value *builtin_num_gt (size_t argc, Value **argv);
+Value *builtin_num_lt (size_t argc, Value **argv);
+Value *builtin_num_gte (size_t argc, Value **argv);
+Value *builtin_num_lte (size_t argc, Value **argv);
+
+// Integer operators for the builtins above
+Value *integer_add (long a, long b);
+Value *integer_sub (long a, long b);
+Value *integer_mul (long a, long b);
+Value *integer_eq (long a, long b);
+Value *integer_gt (long a, long b);
+Value *integer_lt (long a, long b);
+Value *integer_gte (long a, long b);
+Value *integer_lte (long a, long b);
 
 #endif // MATH_H_
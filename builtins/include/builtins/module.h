@@ -2,9 +2,6 @@
 #define MODULE_H_
 
 #include "core/eval.h"
-#include "core/lexer.h"
-#include "core/parser.h"
-#include "core/ast.h"
 #include "core/environment.h"
 #include "core/value.h"
 
@@ -5,21 +5,22 @@
 
 #include "core/value.h"
 #include "core/eval.h"
-#include "core/lexer.h"
-#include "core/parser.h"
-#include "core/ast.h"
 #include "core/environment.h"
 
 #include "builtins/forms.h"
 
-Value *builtin_dump (Environment *environment, Value *arguments);
-Value *builtin_read (Environment *environment, Value *arguments);
-Value *builtin_read_file (Environment *environment, Value *arguments);
+Value *builtin_dump (size_t argc, Value **argv);
+Value *builtin_read (size_t argc, Value **argv);
+Value *builtin_read_file (size_t argc, Value **argv);
+// What load-file and reload-file evaluate a file's forms with:
+// evaluate_expression unless odeus runs on another engine (--vm, --nodes).
+extern Value *(*load_file_evaluate) (Environment *, Value *);
+
 Value *builtin_load_file (Environment *environment, Value *arguments);
 Value *builtin_reload_file (Environment *environment, Value *arguments);
 Value *builtin_show_meta (Environment *environment, Value *arguments);
-Value *builtin_file_to_string (Environment *environment, Value *arguments);
-Value *builtin_write (Environment *environment, Value *arguments);
-Value *builtin_display (Environment *environment, Value *arguments);
+Value *builtin_file_to_string (size_t argc, Value **argv);
+Value *builtin_write (size_t argc, Value **argv);
+Value *builtin_display (size_t argc, Value **argv);
 
 #endif // STDIO_H_
@@ -4,10 +4,10 @@
 #include "core/value.h"
 #include "core/eval.h"
 
-Value *builtin_concat (Environment *environment, Value *arguments);
-Value *builtin_string_length (Environment *environment, Value *arguments);
-Value *builtin_substring (Environment *environment, Value *arguments);
-Value *builtin_string_to_symbol (Environment *environment, Value *arguments);
-Value *builtin_symbol_to_string (Environment *environment, Value *arguments);
+Value *builtin_concat (size_t argc, Value **argv);
+Value *builtin_string_length (size_t argc, Value **argv);
+Value *builtin_substring (size_t argc, Value **argv);
+Value *builtin_string_to_symbol (size_t argc, Value **argv);
+Value *builtin_symbol_to_string (size_t argc, Value **argv);
 
 #endif // STRINGS_H_
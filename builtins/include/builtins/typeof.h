@@ -4,6 +4,6 @@
 #include "core/value.h"
 #include "core/eval.h"
 
-Value *builtin_typeof (Environment *environment, Value *arguments);
+Value *builtin_typeof (size_t argc, Value **argv);
 
 #endif // TYPE_OF_H_
@@ -12,141 +12,113 @@ builtin_apply (Environment *environment, Value *arguments)
   Value *fn = CAR (arguments);
   Value *arg_list = CADR (arguments);
 
-  if (arg_list->type != VALUE_NIL && arg_list->type != VALUE_CONS)
+  if (TYPE (arg_list) != VALUE_NIL && TYPE (arg_list) != VALUE_CONS)
     return val_error ("apply: second argument must be a list");
 
   return apply (environment, fn, arg_list);
 }
 
 Value *
-builtin_cons (Environment *environment, Value *arguments)
+builtin_cons (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 2)
-    return val_error ("ERROR: cons expects two argument\n");
-
-  Value *first_argument = evaluate_expression (environment, CAR (arguments));
-  Value *second_argument = evaluate_expression (environment, CADR (arguments));
+  (void)argc;
 
-  return val_cons (first_argument, second_argument);
+  return val_cons (argv[0], argv[1]);
 }
 
 Value *
-builtin_list (Environment *environment, Value *arguments)
+builtin_list (size_t argc, Value **argv)
 {
   Value *result = val_nil ();
-  Value *lvalue = NULL;
-
-  while (arguments->type == VALUE_CONS)
-    {
-      Value *elem = evaluate_expression (environment, CAR (arguments));
-      ERROR_OUT (elem);
-
-      Value *new_cons = val_cons (elem, val_nil ());
-      if (IS_NULL (result))
-        result = new_cons;
-      else
-        lvalue->as.CONS.CDR = new_cons;
 
-      lvalue = new_cons;
-      arguments = CDR (arguments);
-    }
-
-  if (!IS_NULL (arguments))
-    return val_error ("list: improper list in arguments");
+  for (size_t i = argc; i > 0; i--)
+    result = val_cons (argv[i - 1], result);
 
   return result;
 }
 
 Value *
-builtin_car (Environment *environment, Value *arguments)
+builtin_car (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("car: expects exactly one argument");
+  (void)argc;
 
-  Value *list = evaluate_expression (environment, CAR (arguments));
+  Value *list = argv[0];
 
-  if (list->type != VALUE_CONS)
+  if (TYPE (list) != VALUE_CONS)
     return val_error ("car: argument is not a pair");
 
   return CAR (list);
 }
 
 Value *
-builtin_cdr (Environment *environment, Value *arguments)
+builtin_cdr (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("cdr: expects exactly one argument");
+  (void)argc;
 
-  Value *list = evaluate_expression (environment, CAR (arguments));
+  Value *list = argv[0];
 
-  if (list->type != VALUE_CONS)
+  if (TYPE (list) != VALUE_CONS)
     return val_error ("cdr: argument is not a pair");
 
   return CDR (list);
 }
 
 Value *
-builtin_set_car (Environment *environment, Value *arguments)
+builtin_set_car (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 2)
-    return val_error ("set-car!: expects exactly two argument");
+  (void)argc;
 
-  Value *list = evaluate_expression (environment, CAR (arguments));
-  Value *value = evaluate_expression (environment, CADR (arguments));
+  Value *list = argv[0];
 
-  if (list->type != VALUE_CONS)
+  if (TYPE (list) != VALUE_CONS)
     return val_error ("set-car!: first argument is not a pair");
 
-  CAR (list) = value;
+  CAR (list) = argv[1];
 
   return list;
 }
 
 Value *
-builtin_set_cdr (Environment *environment, Value *arguments)
+builtin_set_cdr (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 2)
-    return val_error ("set-cdr!: expects exactly two argument");
+  (void)argc;
 
-  Value *list = evaluate_expression (environment, CAR (arguments));
-  Value *value = evaluate_expression (environment, CADR (arguments));
+  Value *list = argv[0];
 
-  if (list->type != VALUE_CONS)
+  if (TYPE (list) != VALUE_CONS)
     return val_error ("set-cdr!: first argument is not a pair");
 
-  CDR (list) = value;
+  CDR (list) = argv[1];
 
   return list;
 }
 
 Value *
-builtin_length (Environment *environment, Value *arguments)
+builtin_length (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("length: expects exactly one argument");
+  (void)argc;
 
-  Value *list = evaluate_expression (environment, CAR (arguments));
+  Value *list = argv[0];
 
   int count = 0;
-  while (list->type == VALUE_CONS)
+  while (TYPE (list) == VALUE_CONS)
     {
       count++;
       list = CDR (list);
-    };
+    }
 
   return val_integer (count);
 }
 
 Value *
-builtin_reverse (Environment *environment, Value *arguments)
+builtin_reverse (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("reverse: expects exactly one argument");
+  (void)argc;
 
-  Value *list = evaluate_expression (environment, CAR (arguments));
+  Value *list = argv[0];
   Value *result = val_nil ();
 
-  while (list->type == VALUE_CONS)
+  while (TYPE (list) == VALUE_CONS)
     {
       result = val_cons (CAR (list), result);
       list = CDR (list);
@@ -163,17 +135,18 @@ builtin_filter (Environment *environment, Value *arguments)
 
   Value *function = evaluate_expression (environment, CAR (arguments));
 
-  if (function->type != VALUE_BUILTIN && function->type != VALUE_LAMBDA)
+  if (TYPE (function) != VALUE_BUILTIN && TYPE (function) != VALUE_PRIMITIVE
+      && TYPE (function) != VALUE_LAMBDA)
     return val_error ("filter: first argument must be a function");
 
   Value *list = evaluate_expression (environment, CADR (arguments));
-  if (list->type != VALUE_CONS)
+  if (TYPE (list) != VALUE_CONS)
     return val_error ("filter: second argument should be list/cons");
 
   Value *result_head = val_cons (val_nil (), val_nil ());
   Value *result_tail = result_head;
 
-  while (list->type == VALUE_CONS && !IS_NULL (list))
+  while (TYPE (list) == VALUE_CONS && !IS_NULL (list))
     {
       Value *current_element = CAR (list);
       Value *function_arguments = val_cons (current_element, val_nil ());
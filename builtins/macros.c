@@ -1,5 +1,6 @@
 #include "builtins/macros.h"
 #include "core/eval.h"
+#include "core/expand.h"
 
 #include <gc.h>
 
@@ -10,13 +11,14 @@ builtin_macro (Environment *environment, Value *arguments)
     return val_error ("macro: expects parameter list");
 
   Value *parameters = CAR (arguments);
-  Value *body = CDR (arguments);
+  // as code of its own, like a lambda body (see resolve_lambda)
+  Value *body = macro_expand_body (environment, parameters, CDR (arguments));
 
-  Value *macro = GC_malloc (sizeof (Value));
+  Value *macro = GC_malloc (sizeof (ClosureValue));
   macro->type = VALUE_MACRO;
-  macro->as.CLOSURE.parameters = parameters;
-  macro->as.CLOSURE.body = body;
-  macro->as.CLOSURE.environment = environment;
+  AS_CLOSURE (macro)->parameters = parameters;
+  AS_CLOSURE (macro)->body = body;
+  AS_CLOSURE (macro)->environment = environment;
 
   return macro;
 }
@@ -29,30 +31,29 @@ builtin_defmacro (Environment *environment, Value *arguments)
 
   Value *to_be_defined = CAR (arguments);
 
-  if (to_be_defined->type == VALUE_CONS)
+  if (TYPE (to_be_defined) == VALUE_CONS)
 
     if (IS_NULL (to_be_defined))
       return val_error ("defmacro: macro definition cannot be empty");
 
   Value *func_name = CAR (to_be_defined);
-  if (func_name->type != VALUE_SYMBOL)
+  if (TYPE (func_name) != VALUE_SYMBOL)
     return val_error ("defmacro: macro name must be a symbol");
 
-  Value *current = env_get (environment, func_name);
-  if (current->type != VALUE_ERROR)
+  if (env_is_defined (environment, func_name))
     return val_error ("defmacro: symbol already defined");
 
   Value *params = CDR (to_be_defined);
 
   // Initialize with nil first
-  env_set (environment, func_name, val_nil (), func_name->meta);
+  env_set (environment, func_name, val_nil (), value_meta (func_name));
 
   Value *macro_args = val_cons (params, CDR (arguments));
   Value *macro = builtin_macro (environment, macro_args);
   ERROR_OUT (macro);
 
   // Update the environment with the macro
-  env_update (environment, func_name, macro, func_name->meta);
+  env_update (environment, func_name, macro, value_meta (func_name));
 
   return func_name;
 }
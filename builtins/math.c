@@ -8,18 +8,19 @@
 static Value *
 get_numeric_value (Value *node, double *out, int *is_float)
 {
+  *out = 0.0;
   *is_float = 0;
 
   if (!node)
     return val_error ("numeric operation got null node");
 
-  switch (node->type)
+  switch (TYPE (node))
     {
     case VALUE_INTEGER:
-      *out = (double)node->as.INTEGER;
+      *out = (double)INTEGER_VALUE (node);
       return val_nil ();
     case VALUE_FLOAT:
-      *out = node->as.FLOAT;
+      *out = AS_FLOAT (node)->value;
       *is_float = 1;
       return val_nil ();
     default:
@@ -28,154 +29,121 @@ get_numeric_value (Value *node, double *out, int *is_float)
 }
 
 Value *
-builtin_add (Environment *env, Value *args)
+builtin_add (size_t argc, Value **argv)
 {
   double result = 0.0;
   int has_float = 0;
 
-  while (args->type == VALUE_CONS)
+  for (size_t i = 0; i < argc; i++)
     {
       int is_float = 0;
-      Value *val_node = evaluate_expression (env, CAR (args));
-      ERROR_OUT (val_node);
-
       double value;
-      Value *err = get_numeric_value (val_node, &value, &is_float);
+      Value *err = get_numeric_value (argv[i], &value, &is_float);
       ERROR_OUT (err);
 
       if (is_float)
         has_float = 1;
       result += value;
-
-      args = CDR (args);
     }
 
   return has_float ? val_float (result) : val_integer ((long)result);
 }
 
 Value *
-builtin_sub (Environment *env, Value *args)
+builtin_sub (size_t argc, Value **argv)
 {
-  if (IS_NULL (args))
-    return val_error ("- expects at levalue one argument");
-
   int is_float = 0;
-  Value *first_node = evaluate_expression (env, CAR (args));
-  ERROR_OUT (first_node);
-
   double result;
-  Value *err = get_numeric_value (first_node, &result, &is_float);
+  Value *err = get_numeric_value (argv[0], &result, &is_float);
   ERROR_OUT (err);
 
-  args = CDR (args);
-
-  if (IS_NULL (args))
+  if (argc == 1)
     return is_float ? val_float (-result) : val_integer ((long)-result);
 
   int has_float = is_float;
 
-  while (args->type == VALUE_CONS)
+  for (size_t i = 1; i < argc; i++)
     {
       int arg_float = 0;
-      Value *val_node = evaluate_expression (env, CAR (args));
-      ERROR_OUT (val_node);
-
       double value;
-      err = get_numeric_value (val_node, &value, &arg_float);
+      err = get_numeric_value (argv[i], &value, &arg_float);
       ERROR_OUT (err);
 
       if (arg_float)
         has_float = 1;
       result -= value;
-
-      args = CDR (args);
     }
 
   return has_float ? val_float (result) : val_integer ((long)result);
 }
 
 Value *
-builtin_mul (Environment *env, Value *args)
+builtin_mul (size_t argc, Value **argv)
 {
   double result = 1.0;
   int has_float = 0;
 
-  while (args->type == VALUE_CONS)
+  for (size_t i = 0; i < argc; i++)
     {
       int is_float = 0;
-      Value *val_node = evaluate_expression (env, CAR (args));
-      ERROR_OUT (val_node);
-
       double value;
-      Value *err = get_numeric_value (val_node, &value, &is_float);
+      Value *err = get_numeric_value (argv[i], &value, &is_float);
       ERROR_OUT (err);
 
       if (is_float)
         has_float = 1;
       result *= value;
-
-      args = CDR (args);
     }
 
   return has_float ? val_float (result) : val_integer ((long)result);
 }
 
 Value *
-builtin_div (Environment *env, Value *args)
+builtin_div (size_t argc, Value **argv)
 {
-  if (IS_NULL (args))
-    return val_error ("/ expects at levalue one argument");
-
   int is_float = 0;
-  Value *first_node = evaluate_expression (env, CAR (args));
-  ERROR_OUT (first_node);
-
   double result;
-  Value *err = get_numeric_value (first_node, &result, &is_float);
+  Value *err = get_numeric_value (argv[0], &result, &is_float);
   ERROR_OUT (err);
 
-  args = CDR (args);
-
-  if (IS_NULL (args))
+  if (argc == 1)
     return val_float (1.0 / result);
 
-  while (args->type == VALUE_CONS)
+  for (size_t i = 1; i < argc; i++)
     {
       int arg_float = 0;
-      Value *val_node = evaluate_expression (env, CAR (args));
-      ERROR_OUT (val_node);
-
       double divisor;
-      err = get_numeric_value (val_node, &divisor, &arg_float);
+      err = get_numeric_value (argv[i], &divisor, &arg_float);
       ERROR_OUT (err);
 
       if (divisor == 0.0)
         return val_error ("division by zero");
 
       result /= divisor;
-      args = CDR (args);
     }
 
   return val_float (result);
 }
 
+// Both arguments of a two argument numeric primitive as doubles
+static Value *
+get_numeric_pair (Value **argv, double *a, double *b, int *is_float_a,
+                  int *is_float_b)
+{
+  Value *err = get_numeric_value (argv[0], a, is_float_a);
+  ERROR_OUT (err);
+
+  return get_numeric_value (argv[1], b, is_float_b);
+}
+
 Value *
-builtin_mod (Environment *env, Value *args)
+builtin_mod (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error ("mod expects exactly two arguments");
+  (void)argc;
 
   int is_float_a = 0, is_float_b = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &is_float_a);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &is_float_b);
+  Value *err = get_numeric_pair (argv, &a, &b, &is_float_a, &is_float_b);
   ERROR_OUT (err);
 
   if (b == 0.0)
@@ -185,22 +153,13 @@ builtin_mod (Environment *env, Value *args)
 }
 
 Value *
-builtin_expt (Environment *env, Value *args)
+builtin_expt (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error ("expt expects exactly two arguments");
+  (void)argc;
 
   int is_float_a = 0, is_float_b = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &is_float_a);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &is_float_b);
+  Value *err = get_numeric_pair (argv, &a, &b, &is_float_a, &is_float_b);
   ERROR_OUT (err);
 
   double result = pow (a, b);
@@ -212,34 +171,26 @@ builtin_expt (Environment *env, Value *args)
 }
 
 Value *
-builtin_abs (Environment *env, Value *args)
+builtin_abs (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 1)
-    return val_error ("abs expects exactly one argument");
+  (void)argc;
 
   int is_float = 0;
   double a;
-  Value *node = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node);
-
-  Value *err = get_numeric_value (node, &a, &is_float);
+  Value *err = get_numeric_value (argv[0], &a, &is_float);
   ERROR_OUT (err);
 
   return is_float ? val_float (fabs (a)) : val_integer ((long)fabs (a));
 }
 
 Value *
-builtin_sqrt (Environment *env, Value *args)
+builtin_sqrt (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 1)
-    return val_error ("sqrt expects exactly one argument");
+  (void)argc;
 
   int is_float = 0;
   double a;
-  Value *node = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node);
-
-  Value *err = get_numeric_value (node, &a, &is_float);
+  Value *err = get_numeric_value (argv[0], &a, &is_float);
   ERROR_OUT (err);
 
   if (a < 0.0)
@@ -249,161 +200,157 @@ builtin_sqrt (Environment *env, Value *args)
 }
 
 Value *
-builtin_num_eq (Environment *env, Value *args)
+builtin_num_eq (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error ("= expects exactly two arguments");
+  (void)argc;
 
   int unused1 = 0, unused2 = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &unused1);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &unused2);
+  Value *err = get_numeric_pair (argv, &a, &b, &unused1, &unused2);
   ERROR_OUT (err);
 
   return (a == b) ? val_t () : val_nil ();
 }
 
 Value *
-builtin_num_gt (Environment *env, Value *args)
+builtin_num_gt (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error ("> expects exactly two arguments");
+  (void)argc;
 
   int unused1 = 0, unused2 = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &unused1);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &unused2);
+  Value *err = get_numeric_pair (argv, &a, &b, &unused1, &unused2);
   ERROR_OUT (err);
 
   return (a > b) ? val_t () : val_nil ();
 }
 
 Value *
-builtin_num_lt (Environment *env, Value *args)
+builtin_num_lt (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error ("< expects exactly two arguments");
+  (void)argc;
 
   int unused1 = 0, unused2 = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &unused1);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &unused2);
+  Value *err = get_numeric_pair (argv, &a, &b, &unused1, &unused2);
   ERROR_OUT (err);
 
   return (a < b) ? val_t () : val_nil ();
 }
 
 Value *
-builtin_num_gte (Environment *env, Value *args)
+builtin_num_gte (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error (">= expects exactly two arguments");
+  (void)argc;
 
   int unused1 = 0, unused2 = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &unused1);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &unused2);
+  Value *err = get_numeric_pair (argv, &a, &b, &unused1, &unused2);
   ERROR_OUT (err);
 
   return (a >= b) ? val_t () : val_nil ();
 }
 
 Value *
-builtin_num_lte (Environment *env, Value *args)
+builtin_num_lte (size_t argc, Value **argv)
 {
-  if (arguments_length (args) != 2)
-    return val_error ("<= expects exactly two arguments");
+  (void)argc;
 
   int unused1 = 0, unused2 = 0;
   double a, b;
-
-  Value *node_a = evaluate_expression (env, CAR (args));
-  ERROR_OUT (node_a);
-  Value *err = get_numeric_value (node_a, &a, &unused1);
-  ERROR_OUT (err);
-
-  Value *node_b = evaluate_expression (env, CADR (args));
-  ERROR_OUT (node_b);
-  err = get_numeric_value (node_b, &b, &unused2);
+  Value *err = get_numeric_pair (argv, &a, &b, &unused1, &unused2);
   ERROR_OUT (err);
 
   return (a <= b) ? val_t () : val_nil ();
 }
 
+// Integer operators (see register_integer_operator). They compute in double
+// like the builtins above, so results agree even for huge integers.
 Value *
-builtin_floor (Environment *environment, Value *arguments)
+integer_add (long a, long b)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("floor: expects exactly one arguments");
+  return val_integer ((long)((double)a + (double)b));
+}
 
-  Value *first_node = evaluate_expression (environment, CAR (arguments));
+Value *
+integer_sub (long a, long b)
+{
+  return val_integer ((long)((double)a - (double)b));
+}
+
+Value *
+integer_mul (long a, long b)
+{
+  return val_integer ((long)((double)a * (double)b));
+}
+
+Value *
+integer_eq (long a, long b)
+{
+  return ((double)a == (double)b) ? val_t () : val_nil ();
+}
+
+Value *
+integer_gt (long a, long b)
+{
+  return ((double)a > (double)b) ? val_t () : val_nil ();
+}
+
+Value *
+integer_lt (long a, long b)
+{
+  return ((double)a < (double)b) ? val_t () : val_nil ();
+}
+
+Value *
+integer_gte (long a, long b)
+{
+  return ((double)a >= (double)b) ? val_t () : val_nil ();
+}
+
+Value *
+integer_lte (long a, long b)
+{
+  return ((double)a <= (double)b) ? val_t () : val_nil ();
+}
+
+Value *
+builtin_floor (size_t argc, Value **argv)
+{
+  (void)argc;
 
   double a;
   int is_float;
 
-  Value *err = get_numeric_value (first_node, &a, &is_float);
+  Value *err = get_numeric_value (argv[0], &a, &is_float);
   ERROR_OUT (err);
 
   return val_integer (floor (a));
 }
 
 Value *
-builtin_ceil (Environment *environment, Value *arguments)
+builtin_ceil (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("ceil: expects exactly one arguments");
-
-  Value *first_node = evaluate_expression (environment, CAR (arguments));
+  (void)argc;
 
   double a;
   int is_float;
 
-  Value *err = get_numeric_value (first_node, &a, &is_float);
+  Value *err = get_numeric_value (argv[0], &a, &is_float);
   ERROR_OUT (err);
 
   return val_integer (ceil (a));
 }
 
 Value *
-builtin_round (Environment *environment, Value *arguments)
+builtin_round (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("round: expects exactly one arguments");
-
-  Value *first_node = evaluate_expression (environment, CAR (arguments));
+  (void)argc;
 
   double a;
   int is_float;
 
-  Value *err = get_numeric_value (first_node, &a, &is_float);
+  Value *err = get_numeric_value (argv[0], &a, &is_float);
   ERROR_OUT (err);
 
   return val_integer (round (a));
@@ -7,6 +7,60 @@
 #include "core/value.h"
 #include <gc/gc.h>
 #include <string.h>
+#include <sys/stat.h>
+
+// Modules are read from <name>.ode
+static char *
+module_filename (const char *name)
+{
+  size_t length = strlen (name);
+  char *filename = GC_malloc_atomic (length + sizeof (".ode"));
+  memcpy (filename, name, length);
+  memcpy (filename + length, ".ode", sizeof (".ode"));
+  return filename;
+}
+
+// Whether the file of module is not the one it was loaded from anymore
+static bool
+module_changed (Value *module)
+{
+  struct stat status;
+  if (stat (module_filename (AS_MODULE (module)->name), &status) != 0)
+    return true;
+
+  return (size_t)status.st_size != AS_MODULE (module)->size
+         || status.st_mtim.tv_sec != AS_MODULE (module)->mtime.tv_sec
+         || status.st_mtim.tv_nsec != AS_MODULE (module)->mtime.tv_nsec;
+}
+
+// Load the module called name into a fresh environment, which replaces the
+// one of module when it is being loaded again (so everything holding it sees
+// the new definitions). module is NULL the first time, the module is
+// registered once its file loaded without error.
+static Value *
+load_module (Environment *environment, const char *name, Value *module)
+{
+  char *filename = module_filename (name);
+
+  // before loading: a change made meanwhile is then seen next time
+  struct stat status;
+  if (stat (filename, &status) != 0)
+    return val_error ("load-module: error reading %s: could not find file",
+                      filename);
+
+  Environment *module_environment = env_init (environment);
+  Value *result = builtin_load_file (
+      module_environment, val_cons (val_string (filename), val_nil ()));
+  ERROR_OUT (result);
+
+  if (!module)
+    module = val_module (name, module_environment);
+
+  AS_MODULE (module)->environment = module_environment;
+  AS_MODULE (module)->mtime = status.st_mtim;
+  AS_MODULE (module)->size = status.st_size;
+  return module;
+}
 
 Value *
 builtin_load_module (Environment *environment, Value *arguments)
@@ -16,51 +70,59 @@ builtin_load_module (Environment *environment, Value *arguments)
 
   Value *module_name = CAR (arguments);
   ERROR_OUT (module_name);
-  if (module_name->type != VALUE_SYMBOL)
+  if (TYPE (module_name) != VALUE_SYMBOL)
     return val_error ("load-module: first argument is not a symbol");
 
-  char *module_name_cstr = strdup (module_name->as.SYMBOL);
-  strcat (module_name_cstr, ".ode");
-
-  Value *load_file_args = val_cons (val_string (module_name_cstr), val_nil ());
+  // loading a module again is a no-op until its file changes
+  Value *module = module_map_get (AS_SYMBOL (module_name)->name);
+  if (module && !module_changed (module))
+    return module;
 
-  Environment *module_environment = env_init (environment);
-
-  Value *err = builtin_load_file (module_environment, load_file_args);
-  free (module_name_cstr);
-
-  ERROR_OUT (err);
-  return val_module (module_name->as.SYMBOL, module_environment);
+  return load_module (environment, AS_SYMBOL (module_name)->name, module);
 }
 
 Value *
 builtin_get_from_module (Environment *environment, Value *arguments)
 {
-  (void)environment;
-
   if (arguments_length (arguments) != 2)
     return val_error ("get-from-module: expects exactly 2 arguments");
 
   Value *module_name = CAR (arguments);
   ERROR_OUT (module_name);
-  if (module_name->type != VALUE_SYMBOL)
+  if (TYPE (module_name) != VALUE_SYMBOL)
     return val_error (
         "get-from-module: first argument (module) is not symbol");
 
   Value *symbol_name = CADR (arguments);
   ERROR_OUT (symbol_name);
-  if (symbol_name->type != VALUE_SYMBOL)
+  if (TYPE (symbol_name) != VALUE_SYMBOL)
     return val_error (
         "get-from-symbol: first argument (symbol) is not symbol");
 
-  Value *module = module_map_get (module_name->as.SYMBOL);
+  // modules not loaded yet are on first use, under the global environment:
+  // the first use may be in a function, whose frame the module must not see
+  Value *module = module_map_get (AS_SYMBOL (module_name)->name);
+  if (!module)
+    {
+      Environment *global = environment;
+      while (global->parent)
+        global = global->parent;
+
+      module = load_module (global, AS_SYMBOL (module_name)->name, NULL);
+    }
   ERROR_OUT (module);
-  if (!module || module->type != VALUE_MODULE)
+  if (TYPE (module) != VALUE_MODULE)
     return val_error ("get-from-symbol: Module corrupted");
 
-  Value *result = env_get (module->as.MODULE.environment, symbol_name);
+  // only what the module itself defines, not what it sees from its parents
+  Binding *binding
+      = env_get_own_binding (AS_MODULE (module)->environment, symbol_name);
+  if (!binding)
+    return val_error ("get-from-module: %s does not export %s",
+                      AS_SYMBOL (module_name)->name,
+                      AS_SYMBOL (symbol_name)->name);
 
-  return result;
+  return binding->value;
 }
 
 Value *
@@ -70,14 +132,14 @@ builtin_reload_module (Environment *environment, Value *arguments)
     return val_error ("reload-module: expects exactly one argument");
 
   Value *module_name = CAR (arguments);
-  if (module_name->type != VALUE_SYMBOL)
+  if (TYPE (module_name) != VALUE_SYMBOL)
     return val_error ("reload-module: argument is not symbol");
 
-  char *module_name_cstr = module_name->as.SYMBOL;
+  char *module_name_cstr = AS_SYMBOL (module_name)->name;
 
   Value *module = module_map_get (module_name_cstr);
   if (!module)
     return val_error ("Module %s not found", module_name_cstr);
 
-  return builtin_load_module (environment, arguments);
+  return load_module (environment, module_name_cstr, module);
 }
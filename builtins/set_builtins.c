@@ -10,81 +10,97 @@
 #include "builtins/strings.h"
 #include "builtins/typeof.h"
 
+#include "core/symbol_map.h"
+
 // environment.h
 static const Meta META_BUILTIN = { .filename = "<builtin>", .line_number = 0 };
 #define REGISTER(name, fn)                                                    \
   env_set (environment, val_symbol (name, META_BUILTIN), val_builtin (fn),    \
            META_BUILTIN)
 
+// Ordinary functions: fn gets the values of between min and max arguments
+#define REGISTER_PRIMITIVE(name, fn, min, max)                                \
+  env_set (environment, val_symbol (name, META_BUILTIN),                      \
+           val_primitive (name, fn, min, max), META_BUILTIN)
+#define VARIADIC PRIMITIVE_VARIADIC
+
 void
 set_builtins (Environment *environment)
 {
-  env_set (environment, val_symbol ("t", META_BUILTIN), val_t (),
-           META_BUILTIN);
-  env_set (environment, val_symbol ("nil", META_BUILTIN), val_nil (),
-           META_BUILTIN);
+  env_set (environment, CORE_SYMBOL (T), val_t (), META_BUILTIN);
+  env_set (environment, CORE_SYMBOL (NIL), val_nil (), META_BUILTIN);
 
   REGISTER ("begin", builtin_begin);
   REGISTER ("eval", builtin_eval);
 
   // Control flow
   REGISTER ("if", builtin_if);
-  REGISTER ("eq", builtin_eq);
+  REGISTER_PRIMITIVE ("eq", builtin_eq, 2, 2);
   REGISTER ("and", builtin_and);
   REGISTER ("or", builtin_or);
 
   // List operations
-  REGISTER ("cons", builtin_cons);
-  REGISTER ("list", builtin_list);
-  REGISTER ("car", builtin_car);
-  REGISTER ("cdr", builtin_cdr);
-  REGISTER ("set-car!", builtin_set_car);
-  REGISTER ("set-cdr!", builtin_set_cdr);
-  REGISTER ("length", builtin_length);
-  REGISTER ("reverse", builtin_reverse);
+  REGISTER_PRIMITIVE ("cons", builtin_cons, 2, 2);
+  REGISTER_PRIMITIVE ("list", builtin_list, 0, VARIADIC);
+  REGISTER_PRIMITIVE ("car", builtin_car, 1, 1);
+  REGISTER_PRIMITIVE ("cdr", builtin_cdr, 1, 1);
+  REGISTER_PRIMITIVE ("set-car!", builtin_set_car, 2, 2);
+  REGISTER_PRIMITIVE ("set-cdr!", builtin_set_cdr, 2, 2);
+  REGISTER_PRIMITIVE ("length", builtin_length, 1, 1);
+  REGISTER_PRIMITIVE ("reverse", builtin_reverse, 1, 1);
   // REGISTER ("filter", builtin_filter);
   REGISTER ("apply", builtin_apply);
 
   // Comparison operators
-  REGISTER ("=", builtin_num_eq);
-  REGISTER (">", builtin_num_gt);
-  REGISTER ("<", builtin_num_lt);
-  REGISTER (">=", builtin_num_gte);
-  REGISTER ("<=", builtin_num_lte);
+  REGISTER_PRIMITIVE ("=", builtin_num_eq, 2, 2);
+  REGISTER_PRIMITIVE (">", builtin_num_gt, 2, 2);
+  REGISTER_PRIMITIVE ("<", builtin_num_lt, 2, 2);
+  REGISTER_PRIMITIVE (">=", builtin_num_gte, 2, 2);
+  REGISTER_PRIMITIVE ("<=", builtin_num_lte, 2, 2);
 
-  REGISTER ("typeof", builtin_typeof);
+  REGISTER_PRIMITIVE ("typeof", builtin_typeof, 1, 1);
 
   // String operations
-  REGISTER ("concat", builtin_concat);
-  REGISTER ("string-length", builtin_string_length);
-  REGISTER ("substring", builtin_substring);
-  REGISTER ("string->symbol", builtin_string_to_symbol);
-  REGISTER ("symbol->string", builtin_symbol_to_string);
+  REGISTER_PRIMITIVE ("concat", builtin_concat, 2, VARIADIC);
+  REGISTER_PRIMITIVE ("string-length", builtin_string_length, 1, 1);
+  REGISTER_PRIMITIVE ("substring", builtin_substring, 2, 3);
+  REGISTER_PRIMITIVE ("string->symbol", builtin_string_to_symbol, 1, 1);
+  REGISTER_PRIMITIVE ("symbol->string", builtin_symbol_to_string, 1, 1);
 
   // I/O operations
-  REGISTER ("dump", builtin_dump);
-  REGISTER ("read", builtin_read);
-  REGISTER ("read-file", builtin_read_file); // expects lisp code
+  REGISTER_PRIMITIVE ("dump", builtin_dump, 0, VARIADIC);
+  REGISTER_PRIMITIVE ("read", builtin_read, 1, 1);
+  REGISTER_PRIMITIVE ("read-file", builtin_read_file, 1,
+                      1); // expects lisp code
   REGISTER ("load-file", builtin_load_file);
   REGISTER ("reload-file", builtin_reload_file);
   REGISTER ("show-meta", builtin_show_meta);
-  REGISTER ("file->string",
-            builtin_file_to_string); // just reads file as string
-  REGISTER ("write", builtin_write);
-  REGISTER ("display", builtin_display);
+  REGISTER_PRIMITIVE ("file->string", builtin_file_to_string, 1,
+                      1); // just reads file as string
+  REGISTER_PRIMITIVE ("write", builtin_write, 1, 1);
+  REGISTER_PRIMITIVE ("display", builtin_display, 1, 1);
 
   // Math functions
-  REGISTER ("+", builtin_add);
-  REGISTER ("-", builtin_sub);
-  REGISTER ("*", builtin_mul);
-  REGISTER ("/", builtin_div);
-  REGISTER ("mod", builtin_mod);
-  REGISTER ("expt", builtin_expt);
-  REGISTER ("sqrt", builtin_sqrt);
-  REGISTER ("abs", builtin_abs);
-  REGISTER ("floor", builtin_floor);
-  REGISTER ("ceil", builtin_ceil);
-  REGISTER ("round", builtin_round);
+  REGISTER_PRIMITIVE ("+", builtin_add, 0, VARIADIC);
+  REGISTER_PRIMITIVE ("-", builtin_sub, 1, VARIADIC);
+  REGISTER_PRIMITIVE ("*", builtin_mul, 0, VARIADIC);
+  REGISTER_PRIMITIVE ("/", builtin_div, 1, VARIADIC);
+  REGISTER_PRIMITIVE ("mod", builtin_mod, 2, 2);
+  REGISTER_PRIMITIVE ("expt", builtin_expt, 2, 2);
+  REGISTER_PRIMITIVE ("sqrt", builtin_sqrt, 1, 1);
+  REGISTER_PRIMITIVE ("abs", builtin_abs, 1, 1);
+  REGISTER_PRIMITIVE ("floor", builtin_floor, 1, 1);
+  REGISTER_PRIMITIVE ("ceil", builtin_ceil, 1, 1);
+  REGISTER_PRIMITIVE ("round", builtin_round, 1, 1);
+
+  register_integer_operator (builtin_add, integer_add);
+  register_integer_operator (builtin_sub, integer_sub);
+  register_integer_operator (builtin_mul, integer_mul);
+  register_integer_operator (builtin_num_eq, integer_eq);
+  register_integer_operator (builtin_num_gt, integer_gt);
+  register_integer_operator (builtin_num_lt, integer_lt);
+  register_integer_operator (builtin_num_gte, integer_gte);
+  register_integer_operator (builtin_num_lte, integer_lte);
 
   REGISTER ("get-from-module", builtin_get_from_module);
   REGISTER ("load-module", builtin_load_module);
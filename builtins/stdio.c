@@ -1,25 +1,29 @@
 #include "builtins/stdio.h"
 
+#include <gc/gc.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 
-#include "builtins/forms.h"
-#include "core/ast.h"
+#include "core/code_cache.h"
 #include "core/environment.h"
 #include "core/eval.h"
+#include "core/expand.h"
+#include "core/mapped_file.h"
+#include "core/reader.h"
 #include "core/value.h"
 
+Value *(*load_file_evaluate) (Environment *, Value *) = evaluate_expression;
+
 Value *
-builtin_dump (Environment *environment, Value *arguments)
+builtin_dump (size_t argc, Value **argv)
 {
-  while (arguments->type == VALUE_CONS)
+  for (size_t i = 0; i < argc; i++)
     {
-      Value *value = evaluate_expression (environment, CAR (arguments));
-      ERROR_OUT (value);
-
-      value_print (value);
+      value_print (argv[i]);
       printf (" ");
-
-      arguments = CDR (arguments);
     }
 
   printf ("\n");
@@ -27,57 +31,194 @@ builtin_dump (Environment *environment, Value *arguments)
 }
 
 Value *
-builtin_read (Environment *environment, Value *arguments)
+builtin_read (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("read: expects exactly one argument");
+  (void)argc;
 
-  Value *code = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (code);
-  if (code->type != VALUE_STRING)
+  Value *code = argv[0];
+  if (TYPE (code) != VALUE_STRING)
     return val_error ("read: argument is not string");
 
-  Lexer lexer = lexer_from_string (code->as.STRING, strlen (code->as.STRING));
-  Parser *parser = parser_init (&lexer);
-  AST *expression = parser_parse (parser);
-  Value *lower = val_from_ast (expression);
+  char *string = AS_STRING (code)->value;
+  Lexer lexer = lexer_from_string (string, strlen (string));
+  Reader reader = reader_init (&lexer);
 
-  return lower;
+  return reader_read_program (&reader);
 }
 
 Value *
-builtin_read_file (Environment *environment, Value *arguments)
+builtin_read_file (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("read-file: expects exactly one argument");
+  (void)argc;
 
-  Value *filename = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (filename);
-  if (filename->type != VALUE_STRING)
+  Value *filename = argv[0];
+  if (TYPE (filename) != VALUE_STRING)
     return val_error ("read-file: argument is not string");
 
-  FILE *f = fopen (filename->as.STRING, "r");
-  if (!f)
+  MappedFile file;
+  if (!mapped_file_open (AS_STRING (filename)->value, &file))
     return val_error ("read-file: could not find file");
 
-  fseek (f, 0, SEEK_END);
-  long size = ftell (f);
-  rewind (f);
+  Lexer lexer
+      = lexer_from_file (AS_STRING (filename)->value, file.data, file.size);
+  Reader reader = reader_init (&lexer);
+  Value *program = reader_read_program (&reader);
+
+  mapped_file_close (&file);
+
+  return program;
+}
+
+// What loading a file into an environment evaluated, so reload-file can
+// evaluate only what changed since: per top-level form, its source hash (see
+// Reader.hash) and the symbols it bound. A file has one, for the environment
+// it was loaded into last.
+typedef struct
+{
+  uint64_t hash;
+  Value **symbols;
+  size_t symbols_size;
+} LoadedForm;
+
+typedef struct LoadedFile
+{
+  struct LoadedFile *next;
+  char *path; // real path: the same file however it is named
+  Environment *environment;
+
+  // of the file as loaded, reloading it as long as they hold is a no-op
+  // unless the load failed
+  struct timespec mtime;
+  size_t size;
+  bool failed;
+
+  LoadedForm *forms;
+  size_t forms_size;
+  size_t forms_capacity;
+} LoadedFile;
+
+static LoadedFile *loaded_files = NULL;
+
+// filename's real path if it has one
+static char *
+real_path (const char *filename)
+{
+  char *path = realpath (filename, NULL);
+  if (!path)
+    return GC_strdup (filename);
 
-  char *buffer = malloc (size + 1);
-  fread (buffer, 1, size, f);
-  buffer[size] = '\0';
+  char *copy = GC_strdup (path);
+  free (path);
+  return copy;
+}
 
-  fclose (f);
+// The record of path's last load, if it was into environment
+static LoadedFile *
+loaded_file_get (const char *path, Environment *environment)
+{
+  for (LoadedFile *loaded = loaded_files; loaded; loaded = loaded->next)
+    if (strcmp (loaded->path, path) == 0)
+      return loaded->environment == environment ? loaded : NULL;
 
-  Lexer lexer = lexer_from_file (filename->as.STRING, buffer, size);
-  Parser *parser = parser_init (&lexer);
-  AST *expression = parser_parse (parser);
-  Value *lower = val_from_ast (expression);
+  return NULL;
+}
 
-  free(buffer);
+// A new, empty record of the load of file (at path) into environment,
+// replacing the last one
+static LoadedFile *
+loaded_file_begin (char *path, Environment *environment,
+                   const MappedFile *file)
+{
+  for (LoadedFile **link = &loaded_files; *link; link = &(*link)->next)
+    if (strcmp ((*link)->path, path) == 0)
+      {
+        *link = (*link)->next;
+        break;
+      }
 
-  return lower;
+  LoadedFile *loaded = GC_malloc (sizeof (LoadedFile));
+  loaded->path = path;
+  loaded->environment = environment;
+  loaded->mtime = file->mtime;
+  loaded->size = file->size;
+  loaded->next = loaded_files;
+  loaded_files = loaded;
+  return loaded;
+}
+
+static LoadedForm *
+loaded_file_add (LoadedFile *loaded)
+{
+  if (loaded->forms_size == loaded->forms_capacity)
+    {
+      size_t capacity
+          = loaded->forms_capacity ? loaded->forms_capacity * 2 : 64;
+      LoadedForm *grown = GC_malloc (capacity * sizeof (LoadedForm));
+      if (loaded->forms_size)
+        memcpy (grown, loaded->forms,
+                loaded->forms_size * sizeof (LoadedForm));
+      loaded->forms = grown;
+      loaded->forms_capacity = capacity;
+    }
+
+  LoadedForm *form = &loaded->forms[loaded->forms_size++];
+  *form = (LoadedForm){ 0 };
+  return form;
+}
+
+// Drop what the count forms bound, all at once
+static void
+remove_loaded_forms (Environment *environment, LoadedForm **forms,
+                     size_t count)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++)
+    size += forms[i]->symbols_size;
+  if (!size)
+    return;
+
+  Value **symbols = GC_malloc (size * sizeof (Value *));
+  size = 0;
+  for (size_t i = 0; i < count; i++)
+    {
+      memcpy (symbols + size, forms[i]->symbols,
+              forms[i]->symbols_size * sizeof (Value *));
+      size += forms[i]->symbols_size;
+    }
+
+  env_remove_symbols (environment, symbols, size);
+}
+
+// Evaluate form, with source hash hash, as evaluate_expanded does and note
+// it in loaded. A form that fails is noted with no hash, so it is evaluated
+// again on reload even if it did not change.
+static Value *
+evaluate_form (Environment *environment, Value *form, uint64_t hash,
+               LoadedFile *loaded)
+{
+  size_t index = loaded->forms_size;
+  loaded_file_add (loaded)->hash = hash;
+
+  // a file the form loads into the same environment logs its own forms'
+  // bindings, not this one's
+  BindingLog log = { .environment = environment };
+  BindingLog *outer = env_binding_log;
+  env_binding_log = &log;
+
+  Value *expanded = macro_expand_all (environment, form);
+  Value *result = load_file_evaluate (environment, expanded);
+
+  env_binding_log = outer;
+  loaded->forms[index].symbols = log.symbols;
+  loaded->forms[index].symbols_size = log.size;
+
+  if (TYPE (result) == VALUE_ERROR)
+    {
+      loaded->forms[index].hash = 0;
+      loaded->failed = true;
+    }
+
+  return result;
 }
 
 Value *
@@ -89,36 +230,116 @@ builtin_load_file (Environment *environment, Value *arguments)
   Value *filename = evaluate_expression (environment, CAR (arguments));
   ERROR_OUT (filename);
 
-  if (filename->type != VALUE_STRING)
+  if (TYPE (filename) != VALUE_STRING)
     return val_error ("load-file: filename must be a string");
 
-  Value *read_args = val_cons (filename, val_nil ());
-  Value *program = builtin_read_file (environment, read_args);
+  MappedFile file;
+  if (!mapped_file_open (AS_STRING (filename)->value, &file))
+    return val_error ("load-file: error reading %s: could not find file",
+                      AS_STRING (filename)->value);
 
-  if (program->type == VALUE_ERROR)
+  // loading a file again replaces what it defined: otherwise its defines
+  // would fail
+  char *path = real_path (AS_STRING (filename)->value);
+  LoadedFile *previous = loaded_file_get (path, environment);
+  if (previous)
     {
-      char error_msg[256];
-      snprintf (error_msg, sizeof (error_msg),
-                "load-file: error reading %s: %s", filename->as.STRING,
-                program->as.ERROR.MESSAGE);
-      return val_error (error_msg);
+      LoadedForm **forms
+          = GC_malloc (previous->forms_size * sizeof (LoadedForm *));
+      for (size_t i = 0; i < previous->forms_size; i++)
+        forms[i] = &previous->forms[i];
+      remove_loaded_forms (environment, forms, previous->forms_size);
+    }
+
+  // the data come from the file's code cache when it has a valid one, and
+  // are cached while they are read otherwise
+  Lexer lexer;
+  Reader reader;
+  CodeCacheWriter cache;
+
+  uint64_t *hashes;
+  Value *data = code_cache_read (AS_STRING (filename)->value, &file, &hashes);
+  if (data)
+    reader = reader_from_data (data, hashes);
+  else
+    {
+      lexer = lexer_from_file (AS_STRING (filename)->value, file.data,
+                               file.size);
+      reader = reader_init (&lexer);
+      code_cache_writer_init (&cache, AS_STRING (filename)->value);
+      reader.cache = &cache;
+    }
+
+  LoadedFile *loaded = loaded_file_begin (path, environment, &file);
+
+  Value *result = val_nil ();
+  Value *form;
+  while ((form = reader_next (&reader)))
+    {
+      result = form;
+      if (TYPE (form) == VALUE_ERROR)
+        {
+          loaded->failed = true;
+          break;
+        }
+
+      result = evaluate_form (environment, form, reader.hash, loaded);
+      if (TYPE (result) == VALUE_ERROR)
+        break;
     }
 
-  Value *eval_args = val_cons (program, val_nil ());
-  Value *result = builtin_eval (environment, eval_args);
+  // the value of the last form is evaluated once more, as eval would
+  if (TYPE (result) != VALUE_ERROR)
+    {
+      if (!data)
+        code_cache_write (&cache, &file);
+      result = load_file_evaluate (environment, result);
+    }
+
+  mapped_file_close (&file);
 
-  if (result->type == VALUE_ERROR)
+  if (TYPE (result) == VALUE_ERROR)
     {
       char error_msg[256];
-      snprintf (error_msg, sizeof (error_msg),
-                "load-file: error evaluating %s: %s", filename->as.STRING,
-                result->as.ERROR.MESSAGE);
+      snprintf (error_msg, sizeof (error_msg), "load-file: error %s %s: %s",
+                reader.error.status == ERROR ? "reading" : "evaluating",
+                AS_STRING (filename)->value, AS_ERROR (result)->MESSAGE);
       return val_error (error_msg);
     }
 
   return result;
 }
 
+// A top-level form of a file being reloaded, not read yet
+typedef struct
+{
+  uint64_t hash;
+  Lexer start; // reads it
+} SkippedForm;
+
+// A form of the last load, by source hash
+typedef struct
+{
+  uint64_t hash;
+  size_t index;
+} HashedForm;
+
+static int
+compare_hashed_forms (const void *a, const void *b)
+{
+  const HashedForm *x = a, *y = b;
+  if (x->hash != y->hash)
+    return x->hash < y->hash ? -1 : 1;
+  return (x->index > y->index) - (x->index < y->index);
+}
+
+// Load a file loaded before into the same environment again, reading and
+// evaluating only the top-level forms that are new or changed: the others
+// keep what they bound, what the forms that are gone or changed bound is
+// dropped first. Forms are told apart by their source hash, so moving them
+// or editing comments changes nothing, and forms left alone are not
+// evaluated again even if they use something that changed. Returns the
+// value of the last form evaluated.
 Value *
 builtin_reload_file (Environment *environment, Value *arguments)
 {
@@ -126,25 +347,131 @@ builtin_reload_file (Environment *environment, Value *arguments)
     return val_error ("reload-file: expects exactly one argument");
 
   Value *value = CAR (arguments);
-  if (value->type != VALUE_STRING)
+  if (TYPE (value) != VALUE_STRING)
     return val_error ("reload-file: argument is not string");
 
-  char *val_str = value->as.STRING;
+  char *path = real_path (AS_STRING (value)->value);
+  LoadedFile *previous = loaded_file_get (path, environment);
+  if (!previous)
+    return builtin_load_file (environment, arguments);
+
+  struct stat status;
+  if (!previous->failed && stat (AS_STRING (value)->value, &status) == 0
+      && (size_t)status.st_size == previous->size
+      && status.st_mtim.tv_sec == previous->mtime.tv_sec
+      && status.st_mtim.tv_nsec == previous->mtime.tv_nsec)
+    return val_nil ();
+
+  MappedFile file;
+  if (!mapped_file_open (AS_STRING (value)->value, &file))
+    return val_error ("reload-file: error reading %s: could not find file",
+                      AS_STRING (value)->value);
+
+  // the whole file is skimmed first, so one that does not read leaves what
+  // was loaded alone
+  size_t count = 0;
+  size_t capacity = 64;
+  SkippedForm *forms = GC_malloc_atomic (capacity * sizeof (SkippedForm));
+
+  Lexer lexer
+      = lexer_from_file (AS_STRING (value)->value, file.data, file.size);
+  Lexer start = lexer;
+  Reader reader = reader_init (&lexer);
+  SkippedForm form;
+  while (reader_skip (&reader, &form.hash, &form.start))
+    {
+      if (count == capacity)
+        {
+          capacity *= 2;
+          SkippedForm *grown
+              = GC_malloc_atomic (capacity * sizeof (SkippedForm));
+          memcpy (grown, forms, count * sizeof (SkippedForm));
+          forms = grown;
+        }
+
+      // form.start reads the form after this one
+      forms[count++] = (SkippedForm){ form.hash, start };
+      start = form.start;
+    }
+
+  if (reader.error.status == ERROR)
+    {
+      mapped_file_close (&file);
+      return val_error ("reload-file: error reading %s: %s",
+                        AS_STRING (value)->value, reader.error.message);
+    }
+
+  // pair the forms with unchanged ones of the last load, in order: the
+  // previous forms sorted by hash are searched for the first unused one
+  size_t previous_size = previous->forms_size;
+  HashedForm *old = GC_malloc_atomic (previous_size * sizeof (HashedForm));
+  for (size_t i = 0; i < previous_size; i++)
+    old[i] = (HashedForm){ previous->forms[i].hash, i };
+  qsort (old, previous_size, sizeof (HashedForm), compare_hashed_forms);
+
+  bool *used = GC_malloc_atomic (previous_size);
+  memset (used, 0, previous_size);
+  LoadedForm **kept = GC_malloc (count * sizeof (LoadedForm *));
 
-  for (int i = 0; i < environment->bindings_size; i++)
+  for (size_t i = 0; i < count; i++)
     {
-      Binding binding = environment->bindings[i];
-      if (binding.meta.filename
-          && strcmp (binding.meta.filename, val_str) == 0)
+      size_t low = 0, high = previous_size;
+      while (low < high)
         {
-          for (int j = i; j < environment->bindings_size - 1; j++)
-            environment->bindings[j] = environment->bindings[j + 1];
-          environment->bindings_size--;
-          i--;
+          size_t middle = low + (high - low) / 2;
+          if (old[middle].hash < forms[i].hash)
+            low = middle + 1;
+          else
+            high = middle;
         }
+
+      for (; low < previous_size && old[low].hash == forms[i].hash; low++)
+        if (!used[low])
+          {
+            used[low] = true;
+            kept[i] = &previous->forms[old[low].index];
+            break;
+          }
     }
 
-  return builtin_load_file (environment, arguments);
+  LoadedForm **gone = GC_malloc (previous_size * sizeof (LoadedForm *));
+  size_t gone_size = 0;
+  for (size_t i = 0; i < previous_size; i++)
+    if (!used[i])
+      gone[gone_size++] = &previous->forms[old[i].index];
+  remove_loaded_forms (environment, gone, gone_size);
+
+  // after an error the forms not evaluated yet are left out of the record,
+  // the next reload evaluates them
+  LoadedFile *loaded = loaded_file_begin (path, environment, &file);
+  Value *result = val_nil ();
+
+  for (size_t i = 0; i < count; i++)
+    {
+      if (kept[i])
+        {
+          *loaded_file_add (loaded) = *kept[i];
+          continue;
+        }
+      if (TYPE (result) == VALUE_ERROR)
+        continue;
+
+      reader = reader_init (&forms[i].start);
+      result = reader_next (&reader);
+      if (TYPE (result) == VALUE_ERROR)
+        loaded->failed = true;
+      else
+        result = evaluate_form (environment, result, forms[i].hash, loaded);
+    }
+
+  mapped_file_close (&file);
+
+  if (TYPE (result) == VALUE_ERROR)
+    return val_error ("reload-file: error %s %s: %s",
+                      reader.error.status == ERROR ? "reading" : "evaluating",
+                      AS_STRING (value)->value, AS_ERROR (result)->MESSAGE);
+
+  return result;
 }
 
 Value *
@@ -154,7 +481,7 @@ builtin_show_meta (Environment *environment, Value *arguments)
     return val_error ("show-meta: expects exactly one argument");
 
   Value *symbol = CAR (arguments);
-  if (symbol->type != VALUE_SYMBOL)
+  if (TYPE (symbol) != VALUE_SYMBOL)
     return val_error ("show-meta: argument is not symbol");
 
   Binding *binding = env_get_binding (environment, symbol);
@@ -168,44 +495,34 @@ builtin_show_meta (Environment *environment, Value *arguments)
 }
 
 Value *
-builtin_file_to_string (Environment *environment, Value *arguments)
+builtin_file_to_string (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("file->string: expects exactly one argument");
+  (void)argc;
 
-  Value *filename = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (filename);
-  if (filename->type != VALUE_STRING)
+  Value *filename = argv[0];
+  if (TYPE (filename) != VALUE_STRING)
     return val_error ("file->string: argument is not string");
 
-  FILE *f = fopen (filename->as.STRING, "r");
-  if (!f)
+  MappedFile file;
+  if (!mapped_file_open (AS_STRING (filename)->value, &file))
     return val_error ("file->string: could not find file");
 
-  fseek (f, 0, SEEK_END);
-  long size = ftell (f);
-  rewind (f);
-
-  char *buffer = malloc (size + 1);
-  fread (buffer, 1, size, f);
-  buffer[size] = '\0';
-
-  fclose (f);
-
-  Value* result =val_string (buffer);
+  // copied once, straight from the mapping: a string must not change (or
+  // fault, if the file shrinks) when the file does
+  char *string = GC_malloc_atomic (file.size + 1);
+  memcpy (string, file.data, file.size);
+  string[file.size] = '\0';
+  mapped_file_close (&file);
 
-  free(buffer);
-  return result;
+  return val_string_take (string);
 }
 
 Value *
-builtin_write (Environment *environment, Value *arguments)
+builtin_write (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("write: expects exactly one argument");
+  (void)argc;
 
-  Value *expr = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (expr);
+  Value *expr = argv[0];
 
   char *str = value_to_string (expr);
   if (!str)
@@ -220,15 +537,11 @@ builtin_write (Environment *environment, Value *arguments)
 static void display_value (Value *value);
 
 Value *
-builtin_display (Environment *environment, Value *arguments)
+builtin_display (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("display: expects exactly 1 argument");
+  (void)argc;
 
-  Value *value = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (value);
-
-  display_value (value);
+  display_value (argv[0]);
 
   return val_nil ();
 }
@@ -236,36 +549,43 @@ builtin_display (Environment *environment, Value *arguments)
 static void
 display_value (Value *value)
 {
-  switch (value->type)
+  switch (TYPE (value))
     {
     case VALUE_NIL:
       printf ("nil");
       break;
     case VALUE_INTEGER:
-      printf ("%ld", value->as.INTEGER);
+      printf ("%ld", INTEGER_VALUE (value));
       break;
     case VALUE_FLOAT:
-      printf ("%g", value->as.FLOAT);
+      printf ("%g", AS_FLOAT (value)->value);
       break;
     case VALUE_STRING:
-      printf ("%s", value->as.STRING);
+      printf ("%s", AS_STRING (value)->value);
       break;
     case VALUE_SYMBOL:
-      printf ("%s", value->as.SYMBOL);
+      printf ("%s", AS_SYMBOL (value)->name);
+      break;
+    case VALUE_LOCAL:
+      printf ("%s", AS_SYMBOL (AS_LOCAL (value)->symbol)->name);
+      break;
+    case VALUE_MODULE_REFERENCE:
+      printf ("%s/%s", AS_SYMBOL (AS_MODULE_REFERENCE (value)->module)->name,
+              AS_SYMBOL (AS_MODULE_REFERENCE (value)->symbol)->name);
       break;
 
     case VALUE_CONS:
       {
         printf ("(");
         Value *cur = value;
-        while (cur->type == VALUE_CONS)
+        while (TYPE (cur) == VALUE_CONS)
           {
             display_value (CAR (cur));
             cur = CDR (cur);
-            if (cur->type == VALUE_CONS)
+            if (TYPE (cur) == VALUE_CONS)
               printf (" ");
           }
-        if (cur->type != VALUE_NIL)
+        if (TYPE (cur) != VALUE_NIL)
           {
             printf (" . ");
             display_value (cur);
@@ -278,6 +598,7 @@ display_value (Value *value)
       printf ("<lambda>");
       break;
     case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
       printf ("<builtin>");
       break;
 
@@ -6,33 +6,16 @@
 #include "core/value.h"
 
 Value *
-builtin_concat (Environment *environment, Value *arguments)
+builtin_concat (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) < 2)
-    return val_error ("concat: expects at levalue two arguments");
-
-  Value *evaluated = val_nil ();
-  Value *tail = val_nil ();
-
   size_t total_length = 0;
 
-  while (arguments->type == VALUE_CONS)
+  for (size_t i = 0; i < argc; i++)
     {
-      Value *value = evaluate_expression (environment, CAR (arguments));
-      ERROR_OUT (value);
-
-      if (value->type != VALUE_STRING)
+      if (TYPE (argv[i]) != VALUE_STRING)
         return val_error ("concat: all arguments must be strings");
 
-      total_length += strlen (value->as.STRING);
-
-      Value *cell = val_cons (value, val_nil ());
-      if (IS_NULL (evaluated))
-        evaluated = tail = cell;
-      else
-        tail = tail->as.CONS.CDR = cell;
-
-      arguments = CDR (arguments);
+      total_length += strlen (AS_STRING (argv[i])->value);
     }
 
   char *buffer = malloc (total_length + 1);
@@ -40,15 +23,13 @@ builtin_concat (Environment *environment, Value *arguments)
     return val_error ("concat: memory allocation failed");
 
   char *dst = buffer;
-  Value *current = evaluated;
 
-  while (current->type == VALUE_CONS)
+  for (size_t i = 0; i < argc; i++)
     {
-      const char *src = CAR (current)->as.STRING;
+      const char *src = AS_STRING (argv[i])->value;
       size_t len = strlen (src);
       memcpy (dst, src, len);
       dst += len;
-      current = CDR (current);
     }
 
   *dst = '\0';
@@ -60,54 +41,43 @@ builtin_concat (Environment *environment, Value *arguments)
 }
 
 Value *
-builtin_string_length (Environment *environment, Value *arguments)
+builtin_string_length (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("string-length: expects exactly one argument");
+  (void)argc;
 
-  Value *string = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (string);
+  Value *string = argv[0];
 
-  if (string->type != VALUE_STRING)
+  if (TYPE (string) != VALUE_STRING)
     return val_error ("string-length: argument is not string");
 
-  return val_integer (strlen (string->as.STRING));
+  return val_integer (strlen (AS_STRING (string)->value));
 }
 
 Value *
-builtin_substring (Environment *environment, Value *arguments)
+builtin_substring (size_t argc, Value **argv)
 {
-  int arguments_count = arguments_length (arguments);
-  if (arguments_count < 2 || arguments_count > 3)
-    return val_error (
-        "substring: expects either 2 or 3 arguments: (substring [str] [low "
-        "index] <high index>)");
-
-  Value *string = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (string);
-  if (string->type != VALUE_STRING)
+  Value *string = argv[0];
+  if (TYPE (string) != VALUE_STRING)
     return val_error ("substring: first argument must be a string");
 
-  Value *low_index = evaluate_expression (environment, CADR (arguments));
-  ERROR_OUT (low_index);
-  if (low_index->type != VALUE_INTEGER)
+  Value *low_index = argv[1];
+  if (TYPE (low_index) != VALUE_INTEGER)
     return val_error ("substring: low index must be an integer");
 
   Value *high_index;
-  if (arguments_count == 3)
+  if (argc == 3)
     {
-      high_index = evaluate_expression (environment, CADR (CDR (arguments)));
-      if (high_index->type != VALUE_INTEGER)
+      high_index = argv[2];
+      if (TYPE (high_index) != VALUE_INTEGER)
         return val_error ("substring: high index must be an integer");
     }
   else
-    high_index = val_integer (strlen (string->as.STRING));
-  ERROR_OUT (high_index);
+    high_index = val_integer (strlen (AS_STRING (string)->value));
 
-  const char *str = string->as.STRING;
+  const char *str = AS_STRING (string)->value;
   int len = strlen (str);
-  int low = low_index->as.INTEGER;
-  int high = high_index->as.INTEGER;
+  int low = INTEGER_VALUE (low_index);
+  int high = INTEGER_VALUE (high_index);
 
   // Handle negative indices (Python-style from the end)
   if (low < 0)
@@ -151,10 +121,10 @@ builtin_substring (Environment *environment, Value *arguments)
 }
 
 Value *
-builtin_string_to_symbol (Environment *environment, Value *arguments)
+builtin_string_to_symbol (size_t argc, Value **argv)
 {
-  (void)environment;
-  (void)arguments;
+  (void)argc;
+  (void)argv;
 
   // I yet dont know how to turn string to symbol to be
   // - printable
@@ -165,16 +135,14 @@ builtin_string_to_symbol (Environment *environment, Value *arguments)
 }
 
 Value *
-builtin_symbol_to_string (Environment *environment, Value *arguments)
+builtin_symbol_to_string (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("symbol->string: expects exactly one argument");
+  (void)argc;
 
-  Value *symbol_arg = evaluate_expression (environment, CAR (arguments));
-  ERROR_OUT (symbol_arg);
+  Value *symbol_arg = argv[0];
 
-  if (symbol_arg->type != VALUE_SYMBOL)
+  if (TYPE (symbol_arg) != VALUE_SYMBOL)
     return val_error ("symbol->string: argument must be a symbol");
 
-  return val_string (symbol_arg->as.SYMBOL);
+  return val_string (AS_SYMBOL (symbol_arg)->name);
 }
@@ -1,33 +1,34 @@
 #include "builtins/typeof.h"
 #include "core/value.h"
 #include "core/eval.h"
+#include "core/symbol_map.h"
 
 Value *
-builtin_typeof (Environment *environment, Value *arguments)
+builtin_typeof (size_t argc, Value **argv)
 {
-  if (arguments_length (arguments) != 1)
-    return val_error ("typeof: expects exactly one argument\n");
+  (void)argc;
 
-  Value *expression = evaluate_expression (environment, CAR (arguments));
-  switch (expression->type)
+  Value *expression = argv[0];
+  switch (TYPE (expression))
     {
     case VALUE_NIL:
-      return val_symbol ("nil", expression->meta);
+      return CORE_SYMBOL (NIL);
     case VALUE_SYMBOL:
-      return val_symbol ("symbol", expression->meta);
+      return CORE_SYMBOL (SYMBOL);
     case VALUE_INTEGER:
-      return val_symbol ("integer", expression->meta);
+      return CORE_SYMBOL (INTEGER);
     case VALUE_FLOAT:
-      return val_symbol ("float", expression->meta);
+      return CORE_SYMBOL (FLOAT);
     case VALUE_STRING:
-      return val_symbol ("string", expression->meta);
+      return CORE_SYMBOL (STRING);
     case VALUE_CONS:
-      return val_symbol ("cons", expression->meta);
+      return CORE_SYMBOL (CONS);
     case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
     case VALUE_LAMBDA:
-      return val_symbol ("function", expression->meta);
+      return CORE_SYMBOL (FUNCTION);
     case VALUE_MACRO:
-      return val_symbol ("macro", expression->meta);
+      return CORE_SYMBOL (MACRO);
     case VALUE_ERROR:
       return expression;
     case VALUE_END_OF_FILE:
@@ -0,0 +1,16 @@
+# Run with cmake -DINPUT=<file> -DOUTPUT=<file.c> -DNAME=<name> -P embed.cmake
+# to turn INPUT into a C source defining its bytes as NAME and their count as
+# NAME_size.
+
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" length)
+math(EXPR size "${length} / 2")
+
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+string(REGEX REPLACE "((0x..,){16})" "\\1\n  " bytes "${bytes}")
+
+file(WRITE "${OUTPUT}"
+  "// Generated from ${INPUT} by embed.cmake, do not edit\n"
+  "#include <stddef.h>\n\n"
+  "const unsigned char ${NAME}[] = {\n  ${bytes}\n};\n"
+  "const size_t ${NAME}_size = ${size};\n")
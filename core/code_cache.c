@@ -0,0 +1,445 @@
+#include "core/code_cache.h"
+
+#include <gc/gc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CODE_CACHE_MAGIC 0x4345444fu // "ODEC" read as a little endian word
+
+bool code_cache_enabled = true;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+
+  // the source the cache was written for
+  int64_t mtime_seconds;
+  int64_t mtime_nanoseconds;
+  uint64_t size;
+  uint64_t hash;
+} Header;
+
+// The data are encoded in postfix order, each op a tag byte followed by its
+// operands, so reading them back needs nothing but a stack of values
+typedef enum
+{
+  OP_END,     // no more data
+  OP_DATUM,   // 8 byte source hash: the value on the stack is the next datum
+  OP_NIL,     // push nil
+  OP_SYMBOL,  // index into the symbol table; push that symbol
+  OP_INTEGER, // zigzag encoded value
+  OP_FLOAT,   // 8 bytes, as a double is stored in memory
+  OP_STRING,  // length, then that many bytes
+  OP_LIST,    // count: pop a tail and count elements below it, push the list
+} Op;
+
+typedef struct
+{
+  Value *rest; // of the list whose elements are being encoded
+  size_t count;
+} Pending;
+
+static uint64_t
+content_hash (const char *data, size_t size)
+{
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++)
+    {
+      h ^= (unsigned char)data[i];
+      h *= 1099511628211ull;
+    }
+  return h;
+}
+
+// foo.ode -> foo.odec, anything else gets .odec appended
+static char *
+cache_filename (const char *filename)
+{
+  size_t length = strlen (filename);
+  bool ode = length > 4 && strcmp (filename + length - 4, ".ode") == 0;
+
+  char *result = GC_malloc_atomic (length + 6);
+  memcpy (result, filename, length);
+  strcpy (result + length, ode ? "c" : ".odec");
+  return result;
+}
+
+void
+code_cache_writer_init (CodeCacheWriter *writer, const char *filename)
+{
+  *writer = (CodeCacheWriter){ .filename = filename,
+                               .failed = !code_cache_enabled };
+}
+
+static void
+resize_index (CodeCacheWriter *writer, size_t capacity)
+{
+  writer->index = GC_malloc_atomic (capacity * sizeof (size_t));
+  memset (writer->index, 0, capacity * sizeof (size_t));
+  writer->index_capacity = capacity;
+
+  for (size_t position = 0; position < writer->symbols_size; position++)
+    {
+      size_t i = AS_SYMBOL (writer->symbols[position])->hash % capacity;
+      while (writer->index[i])
+        i = (i + 1) % capacity;
+      writer->index[i] = position + 1;
+    }
+}
+
+// Position of symbol in the writer's symbol table, adding it if it is new
+static size_t
+symbol_position (CodeCacheWriter *writer, Value *symbol)
+{
+  if (2 * (writer->symbols_size + 1) > writer->index_capacity)
+    resize_index (writer, writer->index_capacity ? writer->index_capacity * 2
+                                                 : 256);
+
+  size_t i = AS_SYMBOL (symbol)->hash % writer->index_capacity;
+  while (writer->index[i])
+    {
+      size_t position = writer->index[i] - 1;
+      if (writer->symbols[position] == symbol)
+        return position;
+      i = (i + 1) % writer->index_capacity;
+    }
+
+  if (writer->symbols_size == writer->symbols_capacity)
+    {
+      size_t capacity
+          = writer->symbols_capacity ? writer->symbols_capacity * 2 : 256;
+      Value **symbols = GC_malloc (capacity * sizeof (Value *));
+      if (writer->symbols_size)
+        memcpy (symbols, writer->symbols,
+                writer->symbols_size * sizeof (Value *));
+      writer->symbols = symbols;
+      writer->symbols_capacity = capacity;
+    }
+
+  writer->symbols[writer->symbols_size] = symbol;
+  writer->index[i] = ++writer->symbols_size;
+  return writer->symbols_size - 1;
+}
+
+static void
+put_atom (CodeCacheWriter *writer, Value *atom)
+{
+  switch (TYPE (atom))
+    {
+    case VALUE_NIL:
+      encoder_put_byte (&writer->data, OP_NIL);
+      return;
+    case VALUE_SYMBOL:
+      encoder_put_byte (&writer->data, OP_SYMBOL);
+      encoder_put_unsigned (&writer->data, symbol_position (writer, atom));
+      return;
+    case VALUE_INTEGER:
+      encoder_put_byte (&writer->data, OP_INTEGER);
+      encoder_put_signed (&writer->data, INTEGER_VALUE (atom));
+      return;
+    case VALUE_FLOAT:
+      encoder_put_byte (&writer->data, OP_FLOAT);
+      encoder_put (&writer->data, &AS_FLOAT (atom)->value, sizeof (double));
+      return;
+    case VALUE_STRING:
+      encoder_put_byte (&writer->data, OP_STRING);
+      encoder_put_string (&writer->data, AS_STRING (atom)->value);
+      return;
+    default:
+      // the reader makes nothing else
+      writer->failed = true;
+      return;
+    }
+}
+
+void
+code_cache_writer_add (CodeCacheWriter *writer, Value *datum, uint64_t hash)
+{
+  if (writer->failed)
+    return;
+
+  // lists are walked with a stack of their own, so any nesting depth the
+  // reader accepts can be written
+  Pending *pending = NULL;
+  size_t size = 0, capacity = 0;
+
+  Value *next = datum;
+  while (true)
+    {
+      if (TYPE (next) == VALUE_CONS)
+        {
+          if (size == capacity)
+            {
+              capacity = capacity ? capacity * 2 : 16;
+              Pending *grown = GC_malloc (capacity * sizeof (Pending));
+              if (size)
+                memcpy (grown, pending, size * sizeof (Pending));
+              pending = grown;
+            }
+          pending[size++] = (Pending){ .rest = next, .count = 0 };
+        }
+      else
+        put_atom (writer, next);
+
+      // finish the lists whose elements are all written, their tail goes
+      // on top of them
+      while (size && TYPE (pending[size - 1].rest) != VALUE_CONS)
+        {
+          put_atom (writer, pending[size - 1].rest);
+          encoder_put_byte (&writer->data, OP_LIST);
+          encoder_put_unsigned (&writer->data, pending[size - 1].count);
+          size--;
+        }
+
+      if (!size)
+        break;
+
+      Pending *top = &pending[size - 1];
+      next = CAR (top->rest);
+      top->rest = CDR (top->rest);
+      top->count++;
+    }
+
+  encoder_put_byte (&writer->data, OP_DATUM);
+  encoder_put (&writer->data, &hash, sizeof (hash));
+}
+
+void
+code_cache_write (CodeCacheWriter *writer, const MappedFile *source)
+{
+  if (writer->failed)
+    return;
+
+  Header header = {
+    .magic = CODE_CACHE_MAGIC,
+    .version = CODE_CACHE_VERSION,
+    .mtime_seconds = source->mtime.tv_sec,
+    .mtime_nanoseconds = source->mtime.tv_nsec,
+    .size = source->size,
+    .hash = content_hash (source->data, source->size),
+  };
+
+  // the symbol table goes first, with the line each symbol was first read
+  // on when that was in this file
+  Encoder table = { 0 };
+  encoder_put_unsigned (&table, writer->symbols_size);
+  for (size_t i = 0; i < writer->symbols_size; i++)
+    {
+      Value *symbol = writer->symbols[i];
+      Meta meta = value_meta (symbol);
+      bool here = meta.filename && strcmp (meta.filename, writer->filename) == 0;
+      encoder_put_unsigned (&table, here ? meta.line_number : 0);
+      encoder_put_string (&table, AS_SYMBOL (symbol)->name);
+    }
+
+  encoder_put_byte (&writer->data, OP_END);
+
+  // written under a temporary name and renamed, so a load running at the
+  // same time never sees half a cache
+  char *filename = cache_filename (writer->filename);
+  size_t length = strlen (filename) + 32;
+  char *temporary = GC_malloc_atomic (length);
+  snprintf (temporary, length, "%s.%ld", filename, (long)getpid ());
+
+  FILE *file = fopen (temporary, "wb");
+  if (!file)
+    return;
+
+  bool written = fwrite (&header, sizeof (header), 1, file) == 1
+                 && fwrite (table.bytes, 1, table.size, file) == table.size
+                 && fwrite (writer->data.bytes, 1, writer->data.size, file)
+                        == writer->data.size;
+
+  if (fclose (file) == 0 && written)
+    rename (temporary, filename);
+  else
+    unlink (temporary);
+}
+
+static bool
+is_current (const Header *header, const MappedFile *source)
+{
+  if (header->magic != CODE_CACHE_MAGIC
+      || header->version != CODE_CACHE_VERSION
+      || header->size != source->size)
+    return false;
+
+  if (header->mtime_seconds == source->mtime.tv_sec
+      && header->mtime_nanoseconds == source->mtime.tv_nsec)
+    return true;
+
+  // touched or checked out again, but maybe not changed
+  return header->hash == content_hash (source->data, source->size);
+}
+
+static Value *
+decode (Decoder *decoder, const char *filename, uint64_t **hashes)
+{
+  size_t symbols_size = decoder_get_unsigned (decoder);
+  if (decoder->failed
+      || symbols_size > (size_t)(decoder->end - decoder->at))
+    return NULL;
+
+  Value **symbols = GC_malloc ((symbols_size + 1) * sizeof (Value *));
+  for (size_t i = 0; i < symbols_size; i++)
+    {
+      Meta meta = { .filename = (char *)filename,
+                    .line_number = decoder_get_unsigned (decoder) };
+      size_t length = decoder_get_unsigned (decoder);
+      const unsigned char *name = decoder_get (decoder, length);
+      if (decoder->failed)
+        return NULL;
+
+      symbols[i] = val_symbol_slice ((const char *)name, length, meta);
+    }
+
+  Value *data = val_nil ();
+  Value *tail = NULL;
+  size_t data_size = 0, data_capacity = 0;
+
+  Value **stack = NULL;
+  size_t size = 0, capacity = 0;
+
+  while (!decoder->failed)
+    {
+      unsigned char op = decoder_get_byte (decoder);
+      if (decoder->failed)
+        return NULL;
+
+      Value *value;
+      switch (op)
+        {
+        case OP_END:
+          return size == 0 && decoder->at == decoder->end ? data : NULL;
+
+        case OP_DATUM:
+          {
+            const unsigned char *hash
+                = decoder_get (decoder, sizeof (uint64_t));
+            if (size != 1 || !hash)
+              return NULL;
+
+            if (data_size == data_capacity)
+              {
+                data_capacity = data_capacity ? data_capacity * 2 : 64;
+                uint64_t *grown
+                    = GC_malloc_atomic (data_capacity * sizeof (uint64_t));
+                if (data_size)
+                  memcpy (grown, *hashes, data_size * sizeof (uint64_t));
+                *hashes = grown;
+              }
+            memcpy (&(*hashes)[data_size++], hash, sizeof (uint64_t));
+
+            Value *cell = val_cons (stack[--size], val_nil ());
+            if (tail)
+              CDR (tail) = cell;
+            else
+              data = cell;
+            tail = cell;
+            continue;
+          }
+
+        case OP_NIL:
+          value = val_nil ();
+          break;
+
+        case OP_SYMBOL:
+          {
+            uint64_t i = decoder_get_unsigned (decoder);
+            if (i >= symbols_size)
+              return NULL;
+            value = symbols[i];
+            break;
+          }
+
+        case OP_INTEGER:
+          value = val_integer (decoder_get_signed (decoder));
+          break;
+
+        case OP_FLOAT:
+          {
+            const unsigned char *bytes = decoder_get (decoder, sizeof (double));
+            if (!bytes)
+              return NULL;
+            double number;
+            memcpy (&number, bytes, sizeof (double));
+            value = val_float (number);
+            break;
+          }
+
+        case OP_STRING:
+          {
+            char *string = decoder_get_string (decoder);
+            if (!string)
+              return NULL;
+            value = val_string_take (string);
+            break;
+          }
+
+        case OP_LIST:
+          {
+            uint64_t count = decoder_get_unsigned (decoder);
+            if (decoder->failed || count >= size)
+              return NULL;
+
+            value = stack[--size];
+            for (uint64_t i = 0; i < count; i++)
+              value = val_cons (stack[--size], value);
+            break;
+          }
+
+        default:
+          return NULL;
+        }
+
+      if (decoder->failed)
+        return NULL;
+
+      if (size == capacity)
+        {
+          capacity = capacity ? capacity * 2 : 64;
+          Value **grown = GC_malloc (capacity * sizeof (Value *));
+          if (size)
+            memcpy (grown, stack, size * sizeof (Value *));
+          stack = grown;
+        }
+      stack[size++] = value;
+    }
+
+  return NULL;
+}
+
+Value *
+code_cache_read (const char *filename, const MappedFile *source,
+                 uint64_t **hashes)
+{
+  *hashes = NULL;
+  if (!code_cache_enabled)
+    return NULL;
+
+  MappedFile cache;
+  if (!mapped_file_open (cache_filename (filename), &cache))
+    return NULL;
+
+  Value *data = NULL;
+
+  Header header;
+  if (cache.size >= sizeof (Header))
+    {
+      memcpy (&header, cache.data, sizeof (Header));
+      if (is_current (&header, source))
+        {
+          Decoder decoder = {
+            .at = (const unsigned char *)cache.data + sizeof (Header),
+            .end = (const unsigned char *)cache.data + cache.size,
+          };
+          data = decode (&decoder, filename, hashes);
+        }
+    }
+
+  mapped_file_close (&cache);
+  return data;
+}
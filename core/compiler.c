@@ -0,0 +1,627 @@
+#include "core/compiler.h"
+#include "core/expand.h"
+#include "core/resolve.h"
+#include "core/special_form.h"
+
+#include <gc/gc.h>
+#include <stdbool.h>
+
+#define OPERAND_MAX UINT16_MAX
+
+typedef struct
+{
+  Chunk *chunk;
+  Scope *scope;
+  Environment *environment;
+  Value *error;
+} Compiler;
+
+// jumps waiting for the address they lead to
+typedef struct
+{
+  size_t *at;
+  size_t size;
+  size_t capacity;
+} JumpList;
+
+static void compile (Compiler *compiler, Value *expression, bool tail);
+static void compile_body (Compiler *compiler, Value *body, bool tail);
+
+static Chunk *
+chunk_new (Value *parameters)
+{
+  Chunk *chunk = GC_malloc (sizeof (Chunk));
+  memset (chunk, 0, sizeof (Chunk));
+  chunk->parameters = parameters;
+  return chunk;
+}
+
+static void
+fail (Compiler *compiler, const char *message)
+{
+  if (!compiler->error)
+    compiler->error = val_error (message);
+}
+
+static void
+emit_byte (Compiler *compiler, uint8_t byte)
+{
+  Chunk *chunk = compiler->chunk;
+  if (chunk->code_size == chunk->code_capacity)
+    {
+      size_t capacity = chunk->code_capacity ? chunk->code_capacity * 2 : 64;
+      uint8_t *code = GC_malloc_atomic (capacity);
+      memcpy (code, chunk->code, chunk->code_size);
+
+      chunk->code = code;
+      chunk->code_capacity = capacity;
+    }
+
+  chunk->code[chunk->code_size++] = byte;
+}
+
+static void
+emit_operand (Compiler *compiler, size_t operand)
+{
+  if (operand > OPERAND_MAX)
+    {
+      fail (compiler, "compile: expression too large");
+      operand = 0;
+    }
+
+  emit_byte (compiler, operand & 0xff);
+  emit_byte (compiler, operand >> 8);
+}
+
+static size_t
+add_constant (Compiler *compiler, Value *value)
+{
+  Chunk *chunk = compiler->chunk;
+  if (chunk->constants_size == chunk->constants_capacity)
+    {
+      size_t capacity
+          = chunk->constants_capacity ? chunk->constants_capacity * 2 : 8;
+      Value **constants = GC_malloc (capacity * sizeof (Value *));
+      memcpy (constants, chunk->constants,
+              chunk->constants_size * sizeof (Value *));
+
+      chunk->constants = constants;
+      chunk->constants_capacity = capacity;
+    }
+
+  chunk->constants[chunk->constants_size] = value;
+  return chunk->constants_size++;
+}
+
+static size_t
+add_cache (Compiler *compiler, int hops)
+{
+  Chunk *chunk = compiler->chunk;
+  if (chunk->caches_size == chunk->caches_capacity)
+    {
+      size_t capacity = chunk->caches_capacity ? chunk->caches_capacity * 2 : 4;
+      CallSite *caches = GC_malloc (capacity * sizeof (CallSite));
+      memset (caches, 0, capacity * sizeof (CallSite));
+      memcpy (caches, chunk->caches, chunk->caches_size * sizeof (CallSite));
+
+      chunk->caches = caches;
+      chunk->caches_capacity = capacity;
+    }
+
+  chunk->caches[chunk->caches_size].hops = hops;
+  return chunk->caches_size++;
+}
+
+static void
+emit_constant (Compiler *compiler, OpCode op, Value *value)
+{
+  emit_byte (compiler, op);
+  emit_operand (compiler, add_constant (compiler, value));
+}
+
+// Emit the target operand of a jump, to be filled in by patch_jumps.
+static void
+emit_target (Compiler *compiler, JumpList *jumps)
+{
+  if (jumps->size == jumps->capacity)
+    {
+      size_t capacity = jumps->capacity ? jumps->capacity * 2 : 4;
+      size_t *at = GC_malloc_atomic (capacity * sizeof (size_t));
+      memcpy (at, jumps->at, jumps->size * sizeof (size_t));
+
+      jumps->at = at;
+      jumps->capacity = capacity;
+    }
+
+  jumps->at[jumps->size++] = compiler->chunk->code_size;
+  emit_operand (compiler, 0);
+}
+
+static void
+emit_jump (Compiler *compiler, OpCode op, JumpList *jumps)
+{
+  emit_byte (compiler, op);
+  emit_target (compiler, jumps);
+}
+
+// Point every jump in jumps at the next instruction.
+static void
+patch_jumps (Compiler *compiler, JumpList *jumps)
+{
+  size_t target = compiler->chunk->code_size;
+  if (target > OPERAND_MAX)
+    fail (compiler, "compile: expression too large");
+
+  for (size_t i = 0; i < jumps->size; i++)
+    {
+      compiler->chunk->code[jumps->at[i]] = target & 0xff;
+      compiler->chunk->code[jumps->at[i] + 1] = (target >> 8) & 0xff;
+    }
+
+  jumps->size = 0;
+}
+
+// Leave the function after an expression in tail position.
+static void
+finish (Compiler *compiler, bool tail)
+{
+  if (tail)
+    emit_byte (compiler, OP_RETURN);
+}
+
+// Error exits of a form in tail position need a return to land on; in other
+// positions they just leave the error where the result would be.
+static void
+finish_exits (Compiler *compiler, JumpList *exits, bool tail)
+{
+  if (exits->size == 0)
+    return;
+
+  patch_jumps (compiler, exits);
+  finish (compiler, tail);
+}
+
+static void
+compile_reference (Compiler *compiler, Value *symbol)
+{
+  int depth, slot;
+  switch (scope_lookup (compiler->scope, symbol, &depth, &slot))
+    {
+    case REFERENCE_LOCAL:
+      emit_byte (compiler, OP_LOCAL);
+      emit_operand (compiler, depth);
+      emit_operand (compiler, slot);
+      emit_operand (compiler, add_constant (compiler, symbol));
+      return;
+
+    case REFERENCE_DYNAMIC:
+      emit_constant (compiler, OP_NAME, symbol);
+      return;
+
+    case REFERENCE_FREE:
+      emit_constant (compiler, OP_GLOBAL, symbol);
+      emit_operand (compiler, add_cache (compiler, depth));
+      return;
+    }
+}
+
+static Chunk *
+compile_function (Scope *parent, Environment *environment, Value *parameters,
+                  Value *body, Value **error)
+{
+  Scope scope = scope_init (parent, environment, parameters, body);
+  Compiler compiler = { .chunk = chunk_new (parameters),
+                        .scope = &scope,
+                        .environment = environment,
+                        .error = NULL };
+
+  compile_body (&compiler, body, true);
+
+  if (compiler.error)
+    {
+      *error = compiler.error;
+      return NULL;
+    }
+
+  return compiler.chunk;
+}
+
+// A lambda template: everything of the closure but its environment, which
+// OP_CLOSURE fills in.
+static Value *
+compile_lambda (Compiler *compiler, Value *parameters, Value *body)
+{
+  Value *error = NULL;
+  Chunk *code = compile_function (compiler->scope, compiler->environment,
+                                  parameters, body, &error);
+  if (!code)
+    {
+      if (!compiler->error)
+        compiler->error = error;
+      return val_nil ();
+    }
+
+  Value *lambda = GC_malloc (sizeof (ClosureValue));
+  memset (lambda, 0, sizeof (ClosureValue));
+  lambda->type = VALUE_LAMBDA;
+  AS_CLOSURE (lambda)->parameters = parameters;
+  AS_CLOSURE (lambda)->body = body;
+  closure_compiled (lambda)->chunk = code;
+
+  return lambda;
+}
+
+static void
+compile_body (Compiler *compiler, Value *body, bool tail)
+{
+  if (TYPE (body) != VALUE_CONS)
+    {
+      emit_byte (compiler, OP_NIL);
+      finish (compiler, tail);
+      return;
+    }
+
+  JumpList exits = { 0 };
+  for (; TYPE (CDR (body)) == VALUE_CONS; body = CDR (body))
+    {
+      compile (compiler, CAR (body), false);
+      emit_jump (compiler, OP_CHECK, &exits);
+      emit_byte (compiler, OP_POP);
+    }
+
+  compile (compiler, CAR (body), tail);
+  finish_exits (compiler, &exits, tail);
+}
+
+// The compile_* functions for special forms return false, before emitting
+// anything, for shapes they do not handle. Those forms go to their builtin
+// through OP_EVAL, which also produces the usual error messages.
+
+static bool
+compile_quote (Compiler *compiler, Value *arguments, bool tail)
+{
+  if (arguments_length (arguments) != 1)
+    return false;
+
+  emit_constant (compiler, OP_CONSTANT, CAR (arguments));
+  finish (compiler, tail);
+  return true;
+}
+
+static bool
+compile_if (Compiler *compiler, Value *arguments, bool tail)
+{
+  if (arguments_length (arguments) != 3)
+    return false;
+
+  JumpList exits = { 0 }, otherwise = { 0 }, end = { 0 };
+
+  compile (compiler, CAR (arguments), false);
+  emit_jump (compiler, OP_CHECK, &exits);
+  emit_jump (compiler, OP_JUMP_IF_NIL, &otherwise);
+
+  compile (compiler, CADR (arguments), tail);
+  if (!tail)
+    emit_jump (compiler, OP_JUMP, &end);
+
+  patch_jumps (compiler, &otherwise);
+  compile (compiler, CADR (CDR (arguments)), tail);
+
+  patch_jumps (compiler, &end);
+  finish_exits (compiler, &exits, tail);
+  return true;
+}
+
+// and/or: every argument but the last either decides the result (it stays
+// on the stack and we jump to the end) or is dropped
+static bool
+compile_logic (Compiler *compiler, OpCode op, Value *arguments, bool tail)
+{
+  if (arguments_length (arguments) <= 0)
+    return false;
+
+  JumpList exits = { 0 };
+  for (; TYPE (CDR (arguments)) == VALUE_CONS; arguments = CDR (arguments))
+    {
+      compile (compiler, CAR (arguments), false);
+      emit_jump (compiler, OP_CHECK, &exits);
+      emit_jump (compiler, op, &exits);
+    }
+
+  compile (compiler, CAR (arguments), tail);
+  finish_exits (compiler, &exits, tail);
+  return true;
+}
+
+static bool
+compile_lambda_form (Compiler *compiler, Value *arguments, bool tail)
+{
+  if (TYPE (arguments) != VALUE_CONS)
+    return false;
+
+  emit_constant (compiler, OP_CLOSURE,
+                 compile_lambda (compiler, CAR (arguments), CDR (arguments)));
+  finish (compiler, tail);
+  return true;
+}
+
+static bool
+compile_define (Compiler *compiler, Value *arguments, bool tail)
+{
+  if (TYPE (arguments) != VALUE_CONS || TYPE (CDR (arguments)) != VALUE_CONS)
+    return false;
+
+  Value *target = CAR (arguments);
+  Value *name = TYPE (target) == VALUE_CONS ? CAR (target) : target;
+  if (TYPE (name) != VALUE_SYMBOL)
+    return false;
+
+  JumpList exits = { 0 };
+  size_t k = add_constant (compiler, name);
+
+  emit_byte (compiler, OP_DEFINE);
+  emit_operand (compiler, k);
+  emit_target (compiler, &exits);
+
+  if (TYPE (target) == VALUE_CONS)
+    emit_constant (compiler, OP_CLOSURE,
+                   compile_lambda (compiler, CDR (target), CDR (arguments)));
+  else
+    {
+      compile (compiler, CADR (arguments), false);
+      emit_jump (compiler, OP_CHECK, &exits);
+    }
+
+  emit_byte (compiler, OP_BIND);
+  emit_operand (compiler, k);
+  emit_byte (compiler, OP_CONSTANT);
+  emit_operand (compiler, k);
+
+  patch_jumps (compiler, &exits);
+  finish (compiler, tail);
+  return true;
+}
+
+static bool
+compile_set (Compiler *compiler, Value *arguments, bool tail)
+{
+  if (TYPE (arguments) != VALUE_CONS || TYPE (CDR (arguments)) != VALUE_CONS
+      || TYPE (CAR (arguments)) != VALUE_SYMBOL)
+    return false;
+
+  JumpList exits = { 0 };
+
+  compile (compiler, CADR (arguments), false);
+  emit_jump (compiler, OP_CHECK, &exits);
+  emit_constant (compiler, OP_SET, CAR (arguments));
+
+  patch_jumps (compiler, &exits);
+  finish (compiler, tail);
+  return true;
+}
+
+// let and let* both bind in the current environment, one binding after the
+// other, so they compile the same way
+static bool
+compile_let (Compiler *compiler, Value *arguments, bool tail)
+{
+  if (TYPE (arguments) != VALUE_CONS)
+    return false;
+
+  Value *bindings = CAR (arguments);
+  if (TYPE (bindings) != VALUE_CONS && TYPE (bindings) != VALUE_NIL)
+    return false;
+
+  for (Value *b = bindings; TYPE (b) == VALUE_CONS; b = CDR (b))
+    {
+      Value *binding = CAR (b);
+      if (TYPE (binding) != VALUE_CONS || TYPE (CDR (binding)) != VALUE_CONS
+          || TYPE (CAR (binding)) != VALUE_SYMBOL)
+        return false;
+    }
+
+  JumpList exits = { 0 };
+  for (; TYPE (bindings) == VALUE_CONS; bindings = CDR (bindings))
+    {
+      Value *binding = CAR (bindings);
+      size_t k = add_constant (compiler, CAR (binding));
+
+      emit_byte (compiler, OP_NIL);
+      emit_byte (compiler, OP_BIND);
+      emit_operand (compiler, k);
+
+      compile (compiler, CADR (binding), false);
+      emit_jump (compiler, OP_CHECK, &exits);
+
+      emit_byte (compiler, OP_BIND);
+      emit_operand (compiler, k);
+    }
+
+  compile_body (compiler, CDR (arguments), tail);
+  finish_exits (compiler, &exits, tail);
+  return true;
+}
+
+static void
+compile_call (Compiler *compiler, Value *expression, bool tail)
+{
+  Value *head = CAR (expression);
+  JumpList skip = { 0 };
+
+  int depth, slot;
+  if (TYPE (head) == VALUE_SYMBOL
+      && scope_lookup (compiler->scope, head, &depth, &slot) == REFERENCE_FREE)
+    {
+      emit_constant (compiler, OP_OPERATOR, head);
+      emit_operand (compiler, add_cache (compiler, depth));
+      emit_operand (compiler, add_constant (compiler, expression));
+      emit_target (compiler, &skip);
+    }
+  else
+    compile (compiler, head, false);
+
+  size_t argc = 0;
+  for (Value *arguments = CDR (expression); TYPE (arguments) == VALUE_CONS;
+       arguments = CDR (arguments), argc++)
+    compile (compiler, CAR (arguments), false);
+
+  emit_byte (compiler, tail ? OP_TAIL_CALL : OP_CALL);
+  emit_operand (compiler, argc);
+
+  finish_exits (compiler, &skip, tail);
+}
+
+static void
+compile_form (Compiler *compiler, Value *expression, bool tail)
+{
+  Value *head = CAR (expression);
+  Value *arguments = CDR (expression);
+
+  int depth, slot;
+  SpecialForm form = SPECIAL_NONE;
+  if (TYPE (head) == VALUE_SYMBOL)
+    switch (scope_lookup (compiler->scope, head, &depth, &slot))
+      {
+      case REFERENCE_FREE:
+        form = special_form (head);
+        break;
+
+      case REFERENCE_DYNAMIC:
+        // in an open scope a special form may still be rebound at run time:
+        // only the tree-walker can tell, so it gets the whole form
+        if (special_form (head) != SPECIAL_NONE)
+          {
+            emit_constant (compiler, OP_EVAL, expression);
+            finish (compiler, tail);
+            return;
+          }
+        break;
+
+      case REFERENCE_LOCAL:
+        break;
+      }
+
+  bool compiled = false;
+  switch (form)
+    {
+    case SPECIAL_NONE:
+      compile_call (compiler, expression, tail);
+      return;
+
+    case SPECIAL_QUOTE:
+      compiled = compile_quote (compiler, arguments, tail);
+      break;
+
+    case SPECIAL_IF:
+      compiled = compile_if (compiler, arguments, tail);
+      break;
+
+    case SPECIAL_BEGIN:
+      compile_body (compiler, arguments, tail);
+      return;
+
+    case SPECIAL_AND:
+      compiled = compile_logic (compiler, OP_AND, arguments, tail);
+      break;
+
+    case SPECIAL_OR:
+      compiled = compile_logic (compiler, OP_OR, arguments, tail);
+      break;
+
+    case SPECIAL_LAMBDA:
+      compiled = compile_lambda_form (compiler, arguments, tail);
+      break;
+
+    case SPECIAL_DEFINE:
+      compiled = compile_define (compiler, arguments, tail);
+      break;
+
+    case SPECIAL_SET:
+      compiled = compile_set (compiler, arguments, tail);
+      break;
+
+    case SPECIAL_LET:
+    case SPECIAL_LET_STAR:
+      compiled = compile_let (compiler, arguments, tail);
+      break;
+
+    default:
+      break;
+    }
+
+  if (!compiled)
+    {
+      emit_constant (compiler, OP_EVAL, expression);
+      finish (compiler, tail);
+    }
+}
+
+static void
+compile (Compiler *compiler, Value *expression, bool tail)
+{
+  switch (TYPE (expression))
+    {
+    case VALUE_CONS:
+      compile_form (compiler, expression, tail);
+      return;
+
+    case VALUE_SYMBOL:
+      compile_reference (compiler, expression);
+      break;
+
+    case VALUE_LOCAL:
+      // already resolved for the tree-walker; frames have the same layout
+      // here, but the scope analysis is redone on the symbol anyway
+      compile_reference (compiler, AS_LOCAL (expression)->symbol);
+      break;
+
+    case VALUE_MODULE_REFERENCE:
+      emit_constant (compiler, OP_MODULE, expression);
+      break;
+
+    case VALUE_NIL:
+      emit_byte (compiler, OP_NIL);
+      break;
+
+    default:
+      emit_constant (compiler, OP_CONSTANT, expression);
+      break;
+    }
+
+  finish (compiler, tail);
+}
+
+Chunk *
+compile_expression (Environment *environment, Value *expression,
+                    Value **error)
+{
+  Value *expanded = macro_expand_all (environment, expression);
+
+  Compiler compiler = { .chunk = chunk_new (val_nil ()),
+                        .scope = NULL,
+                        .environment = environment,
+                        .error = NULL };
+
+  compile (&compiler, expanded, true);
+
+  if (compiler.error)
+    {
+      *error = compiler.error;
+      return NULL;
+    }
+
+  return compiler.chunk;
+}
+
+Chunk *
+compile_closure (Value *closure, Value **error)
+{
+  Environment *environment = AS_CLOSURE (closure)->environment;
+  Value *parameters = AS_CLOSURE (closure)->parameters;
+
+  Value *body
+      = macro_expand_body (environment, parameters,
+                           AS_CLOSURE (closure)->body);
+
+  return compile_function (NULL, environment, parameters, body, error);
+}
@@ -0,0 +1,126 @@
+#include "core/encoding.h"
+
+#include <gc/gc.h>
+#include <string.h>
+
+void
+encoder_put (Encoder *encoder, const void *bytes, size_t size)
+{
+  if (encoder->size + size > encoder->capacity)
+    {
+      size_t capacity = encoder->capacity ? encoder->capacity * 2 : 4096;
+      while (capacity < encoder->size + size)
+        capacity *= 2;
+
+      unsigned char *grown = GC_malloc_atomic (capacity);
+      if (encoder->size)
+        memcpy (grown, encoder->bytes, encoder->size);
+      encoder->bytes = grown;
+      encoder->capacity = capacity;
+    }
+
+  memcpy (encoder->bytes + encoder->size, bytes, size);
+  encoder->size += size;
+}
+
+void
+encoder_put_byte (Encoder *encoder, unsigned char byte)
+{
+  encoder_put (encoder, &byte, 1);
+}
+
+void
+encoder_put_unsigned (Encoder *encoder, uint64_t value)
+{
+  unsigned char bytes[10];
+  size_t size = 0;
+
+  do
+    {
+      bytes[size] = value & 0x7f;
+      value >>= 7;
+      if (value)
+        bytes[size] |= 0x80;
+      size++;
+    }
+  while (value);
+
+  encoder_put (encoder, bytes, size);
+}
+
+void
+encoder_put_signed (Encoder *encoder, int64_t value)
+{
+  uint64_t bits = value;
+  encoder_put_unsigned (encoder, (bits << 1) ^ -(bits >> 63));
+}
+
+void
+encoder_put_string (Encoder *encoder, const char *string)
+{
+  size_t length = strlen (string);
+  encoder_put_unsigned (encoder, length);
+  encoder_put (encoder, string, length);
+}
+
+const unsigned char *
+decoder_get (Decoder *decoder, size_t size)
+{
+  if (decoder->failed || (size_t)(decoder->end - decoder->at) < size)
+    {
+      decoder->failed = true;
+      return NULL;
+    }
+
+  const unsigned char *bytes = decoder->at;
+  decoder->at += size;
+  return bytes;
+}
+
+unsigned char
+decoder_get_byte (Decoder *decoder)
+{
+  const unsigned char *byte = decoder_get (decoder, 1);
+  return byte ? *byte : 0;
+}
+
+uint64_t
+decoder_get_unsigned (Decoder *decoder)
+{
+  uint64_t value = 0;
+
+  for (int shift = 0; shift < 64 && !decoder->failed; shift += 7)
+    {
+      if (decoder->at == decoder->end)
+        break;
+
+      unsigned char byte = *decoder->at++;
+      value |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+
+  decoder->failed = true;
+  return 0;
+}
+
+int64_t
+decoder_get_signed (Decoder *decoder)
+{
+  uint64_t bits = decoder_get_unsigned (decoder);
+  return (int64_t)((bits >> 1) ^ -(bits & 1));
+}
+
+char *
+decoder_get_string (Decoder *decoder)
+{
+  size_t length = decoder_get_unsigned (decoder);
+  const unsigned char *bytes = decoder_get (decoder, length);
+  if (!bytes)
+    return NULL;
+
+  char *string = GC_malloc_atomic (length + 1);
+  memcpy (string, bytes, length);
+  string[length] = '\0';
+  return string;
+}
@@ -1,76 +1,331 @@
 #include "core/environment.h"
 #include "core/value.h"
 #include <gc/gc.h>
+#include <stdint.h>
+
+unsigned long env_version = 0;
+unsigned long macro_version = 0;
+bool macro_names_shadowed = false;
+BindingLog *env_binding_log = NULL;
+
+static void
+note_macro_binding (Environment *environment, Value *symbol, Value *value)
+{
+  if (symbol->flags & VALUE_FLAG_MACRO_NAME)
+    {
+      macro_version++;
+      if (environment->is_frame || TYPE (value) != VALUE_MACRO)
+        macro_names_shadowed = true;
+    }
+  else if (TYPE (value) == VALUE_MACRO)
+    symbol->flags |= VALUE_FLAG_MACRO_NAME;
+}
+
+static void
+log_binding (Environment *environment, Value *symbol)
+{
+  BindingLog *log = env_binding_log;
+  if (!log || log->environment != environment)
+    return;
+
+  if (log->size == log->capacity)
+    {
+      size_t capacity = log->capacity ? log->capacity * 2 : 4;
+      Value **symbols = GC_malloc (capacity * sizeof (Value *));
+      if (log->size)
+        memcpy (symbols, log->symbols, log->size * sizeof (Value *));
+      log->symbols = symbols;
+      log->capacity = capacity;
+    }
+
+  log->symbols[log->size++] = symbol;
+}
 
 Environment *
 env_init (Environment *parent)
 {
-  Environment *environment = GC_malloc (sizeof (Environment));
-  memset (environment, 0, sizeof (Environment));
+  return env_init_with_capacity (parent, ENV_INITIAL_CAPACITY);
+}
+
+Environment *
+env_init_with_capacity (Environment *parent, size_t capacity)
+{
+  size_t size = sizeof (Environment) + capacity * sizeof (Binding);
+
+  Environment *environment = GC_malloc (size);
+  memset (environment, 0, size);
   environment->parent = parent;
+  environment->bindings = environment->inline_bindings;
   environment->bindings_size = 0;
+  environment->bindings_capacity = capacity;
   return environment;
 }
 
+Environment *
+env_init_frame (Environment *parent, size_t capacity)
+{
+  Environment *frame = env_init_with_capacity (parent, capacity);
+  frame->is_frame = true;
+  return frame;
+}
+
+static size_t
+symbol_hash (Value *symbol)
+{
+  // symbols are interned, so their address identifies them
+  return (size_t)(((uintptr_t)symbol >> 4) * 0x9E3779B97F4A7C15ull);
+}
+
+static void
+index_insert (Environment *environment, size_t slot)
+{
+  size_t mask = environment->index_capacity - 1;
+  size_t i = symbol_hash (environment->bindings[slot].key) & mask;
+
+  while (environment->index[i])
+    i = (i + 1) & mask;
+
+  environment->index[i] = slot + 1;
+}
+
 void
-env_set (Environment *environment, Value *symbol, Value *value, Meta meta)
+env_reindex (Environment *environment)
+{
+  if (environment->bindings_size <= ENV_INDEX_THRESHOLD)
+    {
+      environment->index = NULL;
+      environment->index_capacity = 0;
+      return;
+    }
+
+  size_t capacity = 64;
+  while (capacity < environment->bindings_size * 2)
+    capacity *= 2;
+
+  environment->index = GC_malloc_atomic (capacity * sizeof (size_t));
+  memset (environment->index, 0, capacity * sizeof (size_t));
+  environment->index_capacity = capacity;
+
+  for (size_t slot = 0; slot < environment->bindings_size; slot++)
+    index_insert (environment, slot);
+}
+
+static long
+find_slot (Environment *environment, Value *symbol)
 {
-  for (int i = 0; i < environment->bindings_size; i++)
+  if (environment->index)
+    {
+      size_t mask = environment->index_capacity - 1;
+      size_t i = symbol_hash (symbol) & mask;
+
+      for (; environment->index[i]; i = (i + 1) & mask)
+        {
+          size_t slot = environment->index[i] - 1;
+          if (environment->bindings[slot].key == symbol)
+            return slot;
+        }
+
+      return -1;
+    }
+
+  for (size_t i = 0; i < environment->bindings_size; i++)
     if (environment->bindings[i].key == symbol)
-      {
-        environment->bindings[i].value = value;
-        environment->bindings[i].meta = meta;
-        return;
-      }
+      return i;
+
+  return -1;
+}
+
+static void
+env_grow (Environment *environment)
+{
+  size_t new_capacity = environment->bindings_capacity
+                            ? environment->bindings_capacity * 2
+                            : ENV_INITIAL_CAPACITY;
+
+  Binding *bindings = GC_malloc (new_capacity * sizeof (Binding));
+  memset (bindings, 0, new_capacity * sizeof (Binding));
+  memcpy (bindings, environment->bindings,
+          environment->bindings_size * sizeof (Binding));
+
+  environment->bindings = bindings;
+  environment->bindings_capacity = new_capacity;
+}
+
+void
+env_set (Environment *environment, Value *symbol, Value *value, Meta meta)
+{
+  note_macro_binding (environment, symbol, value);
+
+  long slot = find_slot (environment, symbol);
+  if (slot >= 0)
+    {
+      if (environment->bindings[slot].redefinable)
+        log_binding (environment, symbol);
+
+      environment->bindings[slot].value = value;
+      environment->bindings[slot].meta = meta;
+      environment->bindings[slot].redefinable = false;
+      return;
+    }
+
+  if (environment->bindings_size == environment->bindings_capacity)
+    env_grow (environment);
 
   environment->bindings[environment->bindings_size].key = symbol;
   environment->bindings[environment->bindings_size].value = value;
   environment->bindings[environment->bindings_size].meta = meta;
+  environment->bindings[environment->bindings_size].redefinable = false;
   environment->bindings_size++;
+
+  if (!environment->is_frame)
+    {
+      env_version++;
+      log_binding (environment, symbol);
+    }
+
+  // keep the index at most half full
+  if (environment->index
+      && environment->bindings_size * 2 <= environment->index_capacity)
+    index_insert (environment, environment->bindings_size - 1);
+  else if (environment->bindings_size > ENV_INDEX_THRESHOLD)
+    env_reindex (environment);
 }
 
 void
 env_update (Environment *environment, Value *symbol, Value *value, Meta meta)
 {
-  for (int i = 0; i < environment->bindings_size; i++)
-    if (environment->bindings[i].key == symbol)
-      {
-        environment->bindings[i].value = value;
-        environment->bindings[i].meta = meta;
-        return;
-      }
-
   env_set (environment, symbol, value, meta);
 }
 
+// Whether define must refuse to bind symbol in environment: some binding of
+// it is visible, and not one define may replace
+bool
+env_is_defined (Environment *environment, Value *symbol)
+{
+  Binding *binding = env_get_binding (environment, symbol);
+  return binding && !binding->redefinable;
+}
+
+// Mark the bindings of environment that except does not have redefinable
+void
+env_mark_redefinable (Environment *environment, Environment *except)
+{
+  for (size_t i = 0; i < environment->bindings_size; i++)
+    if (!env_get_own_binding (except, environment->bindings[i].key))
+      environment->bindings[i].redefinable = true;
+}
+
 Value *
 env_get (Environment *environment, Value *symbol)
 {
-  for (int i = 0; i < environment->bindings_size; i++)
-    if (environment->bindings[i].key->as.SYMBOL == symbol->as.SYMBOL)
-      return environment->bindings[i].value;
+  Binding *binding = env_get_binding (environment, symbol);
+  if (binding)
+    return binding->value;
+
+  char buf[256];
+  snprintf (buf, sizeof (buf), "Unbound symbol: %s",
+            AS_SYMBOL (symbol)->name); // need to somehow provide symbol as character
+  return val_error (buf);
+}
 
-  if (environment->parent == NULL)
+Binding *
+env_get_binding (Environment *environment, Value *symbol)
+{
+  for (; environment; environment = environment->parent)
     {
-      char buf[256];
-      snprintf (
-          buf, sizeof (buf), "Unbound symbol: %s",
-          symbol->as.SYMBOL); // need to somehow provide symbol as character
-      return val_error (buf);
+      long slot = find_slot (environment, symbol);
+      if (slot >= 0)
+        return &environment->bindings[slot];
     }
 
-  return env_get (environment->parent, symbol);
+  return NULL;
 }
 
+// The binding of symbol in environment itself, not in its parents
 Binding *
-env_get_binding (Environment *environment, Value *symbol)
+env_get_own_binding (Environment *environment, Value *symbol)
+{
+  long slot = find_slot (environment, symbol);
+  return slot >= 0 ? &environment->bindings[slot] : NULL;
+}
+
+// Like env_get_binding, but only succeeds when no call frame sits between
+// environment and the binding, i.e. when env_version covers every change
+// that could make the result stale.
+Binding *
+env_get_cacheable_binding (Environment *environment, Value *symbol)
+{
+  for (; environment && !environment->is_frame;
+       environment = environment->parent)
+    {
+      long slot = find_slot (environment, symbol);
+      if (slot >= 0)
+        return &environment->bindings[slot];
+    }
+
+  return NULL;
+}
+
+// Drop the bindings whose key was cleared, keeping the order of the rest.
+static size_t
+remove_cleared (Environment *environment)
+{
+  size_t kept = 0;
+
+  for (size_t i = 0; i < environment->bindings_size; i++)
+    if (environment->bindings[i].key)
+      environment->bindings[kept++] = environment->bindings[i];
+
+  size_t removed = environment->bindings_size - kept;
+  memset (&environment->bindings[kept], 0, removed * sizeof (Binding));
+  environment->bindings_size = kept;
+
+  if (removed)
+    {
+      env_reindex (environment);
+      env_version++;
+    }
+
+  return removed;
+}
+
+static void
+clear_binding (Binding *binding)
+{
+  if (binding->key->flags & VALUE_FLAG_MACRO_NAME)
+    macro_version++;
+  binding->key = NULL;
+}
+
+// Drop the bindings of the count symbols at once, keeping the order of the
+// rest. Symbols not bound here are skipped.
+size_t
+env_remove_symbols (Environment *environment, Value **symbols, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    {
+      long slot = find_slot (environment, symbols[i]);
+      if (slot >= 0)
+        clear_binding (&environment->bindings[slot]);
+    }
+
+  return remove_cleared (environment);
+}
+
+// Fetch a VALUE_LOCAL reference by walking a fixed number of frames. The key
+// check guards against frames whose layout differs from what resolve_lambda
+// assumed; such references fall back to a regular lookup.
+Value *
+env_get_local (Environment *environment, Value *local)
 {
-  for (int i = 0; i < environment->bindings_size; i++)
-    if (environment->bindings[i].key->as.SYMBOL == symbol->as.SYMBOL)
-      return &environment->bindings[i];
+  Environment *frame = environment;
+  for (int depth = AS_LOCAL (local)->depth; depth > 0 && frame; depth--)
+    frame = frame->parent;
 
-  if (environment->parent == NULL)
-    return NULL;
+  size_t slot = AS_LOCAL (local)->slot;
+  if (frame && slot < frame->bindings_size
+      && frame->bindings[slot].key == AS_LOCAL (local)->symbol)
+    return frame->bindings[slot].value;
 
-  return env_get_binding (environment->parent, symbol);
+  return env_get (environment, AS_LOCAL (local)->symbol);
 }
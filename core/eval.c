@@ -1,97 +1,388 @@
 #include "core/eval.h"
+#include "core/expand.h"
+#include "core/module_map.h"
+#include "core/symbol_map.h"
 #include "core/value.h"
 
+#include <gc/gc.h>
+
 static Value *bind_arguments (Environment *call_env, Environment *frame, Value *parameters,
                             Value *arguments);
 
 static Value *bind_macro_arguments (Environment *frame, Value *parameters, Value *arguments);
 
+static size_t parameters_count (Value *parameters);
+
+static Value *expand_macro (Value *macro, Value *expression);
+static Value *apply_primitive (Environment *environment, Value *primitive,
+                               Value *arguments);
+static void quicken_primitive (CallSite *site, Value *primitive,
+                               Value *arguments);
+static Value *call_integer (Environment *environment, CallSite *site,
+                            Value *arguments);
+static bool expansion_is_current (Environment *environment, CallSite *site,
+                                  Value *op);
+static Value *enter_lambda (Environment *call_env, Value *function,
+                            Value *arguments, Environment **frame);
+
+// Returned by builtins (through eval_tail_call) instead of a value when the
+// rest of their work is evaluating one expression in tail position.
+static Value TAIL_CALL = { .type = VALUE_TAIL_CALL };
+static Environment *pending_environment = NULL;
+static Value *pending_expression = NULL;
+
 Value *
 evaluate_expression (Environment *environment, Value *expression)
 {
-  if (!expression)
-    return val_nil ();
+  // Tail positions (the last body form of a lambda, macro expansions and
+  // whatever builtins hand back through eval_tail_call) are evaluated by
+  // going around this loop instead of recursing, so iterative Lisp code
+  // runs in constant C stack.
+  while (true)
+    {
+      if (!expression)
+        return val_nil ();
+
+      switch (TYPE (expression))
+        {
+        case VALUE_INTEGER:
+        case VALUE_FLOAT:
+        case VALUE_STRING:
+        case VALUE_NIL:
+        case VALUE_LAMBDA:
+        case VALUE_MACRO:
+          return expression;
+
+        case VALUE_SYMBOL:
+          return env_get (environment, expression);
+
+        case VALUE_LOCAL:
+          return env_get_local (environment, expression);
+
+        case VALUE_MODULE_REFERENCE:
+          return module_reference_get (environment, expression);
+
+        case VALUE_CONS:
+          {
+            Value *op = CAR (expression);
+            Value *args = CDR (expression);
+
+            // Call forms are specialised as they run: their site remembers
+            // the primitive they call, or the expansion of the macro call
+            // they are, which stands in for them from then on.
+            // Only code the expander made has a site: data handed to the
+            // evaluator some other way runs unspecialised.
+            CallSite *site = NULL;
+            if (expression->flags & VALUE_FLAG_CODE)
+              {
+                site = AS_CODE (expression)->SITE;
+                if (!site && TYPE (op) == VALUE_SYMBOL)
+                  site = AS_CODE (expression)->SITE = call_site_new (0);
+              }
+
+            if (site && site->expansion)
+              {
+                if (expansion_is_current (environment, site, op))
+                  {
+                    expression = site->expansion;
+                    continue;
+                  }
+                site->expansion = NULL;
+              }
+
+            Value *fn;
+            if (TYPE (op) != VALUE_SYMBOL)
+              fn = evaluate_expression (environment, op);
+            else if (site)
+              fn = call_site_lookup (site, environment, op);
+            else
+              fn = env_get (environment, op);
+
+            ERROR_OUT (fn);
+
+            if (TYPE (fn) == VALUE_PRIMITIVE)
+              {
+                if (site && fn != site->primitive)
+                  quicken_primitive (site, fn, args);
+                if (site && site->integer)
+                  return call_integer (environment, site, args);
+
+                return apply_primitive (environment, fn, args);
+              }
+
+            if (TYPE (fn) == VALUE_MACRO && TYPE (op) == VALUE_SYMBOL)
+              {
+                Value *expanded = expand_macro (fn, expression);
+                ERROR_OUT (expanded);
+
+                if (site)
+                  {
+                    expanded = macro_expand_all (environment, expanded);
+                    site->expansion = expanded;
+                    site->macro = fn;
+                    site->expansion_version = macro_version;
+                  }
+                expression = expanded;
+                continue;
+              }
+
+            if (TYPE (fn) == VALUE_BUILTIN)
+              {
+                Value *result = AS_BUILTIN (fn)->function (environment, args);
+                if (result != &TAIL_CALL)
+                  return result;
+
+                environment = pending_environment;
+                expression = pending_expression;
+                continue;
+              }
+
+            if (TYPE (fn) == VALUE_LAMBDA)
+              {
+                Environment *frame;
+                expression = enter_lambda (environment, fn, args, &frame);
+                environment = frame;
+                continue;
+              }
+
+            return val_error ("attempt to call non-function");
+          }
+
+        case VALUE_ERROR:
+        case VALUE_END_OF_FILE:
+          return expression;
+
+        default:
+          return val_error ("evaluate_expression: unknown VALUE type");
+        }
+    }
+}
+
+Value *
+eval_tail_call (Environment *environment, Value *expression)
+{
+  pending_environment = environment;
+  pending_expression = expression;
+  return &TAIL_CALL;
+}
+
+Value *
+eval_trampoline (Value *result)
+{
+  if (result != &TAIL_CALL)
+    return result;
+
+  return evaluate_expression (pending_environment, pending_expression);
+}
+
+int
+arguments_length (Value *arguments)
+{
+  int count = 0;
 
-  switch (expression->type)
+  while (TYPE (arguments) == VALUE_CONS)
     {
-    case VALUE_INTEGER:
-    case VALUE_FLOAT:
-    case VALUE_STRING:
-    case VALUE_NIL:
-    case VALUE_LAMBDA:
-    case VALUE_MACRO:
-      return expression;
+      count++;
+      arguments = CDR (arguments);
+    }
 
-    case VALUE_SYMBOL:
-      return env_get (environment, expression);
+  return count;
+}
 
-    case VALUE_CONS:
-      {
-        Value *expanded = macro_expand_expression (environment, expression);
-        ERROR_OUT (expanded);
+CallSite *
+call_site_new (int hops)
+{
+  CallSite *site = GC_malloc (sizeof (CallSite));
+  memset (site, 0, sizeof (CallSite));
+  site->hops = hops;
+  return site;
+}
 
-        if (expanded != expression)
-          return evaluate_expression (environment, expanded);
+static struct
+{
+  Primitive_Function primitive;
+  Integer_Operator integer;
+} INTEGER_OPERATORS[16];
+static size_t INTEGER_OPERATORS_SIZE = 0;
+
+void
+register_integer_operator (Primitive_Function primitive,
+                           Integer_Operator integer)
+{
+  // set_builtins may run more than once (see image.c)
+  for (size_t i = 0; i < INTEGER_OPERATORS_SIZE; i++)
+    if (INTEGER_OPERATORS[i].primitive == primitive)
+      return;
 
-        Value *op = CAR (expression);
-        Value *args = CDR (expression);
+  if (INTEGER_OPERATORS_SIZE
+      < sizeof (INTEGER_OPERATORS) / sizeof (INTEGER_OPERATORS[0]))
+    {
+      INTEGER_OPERATORS[INTEGER_OPERATORS_SIZE].primitive = primitive;
+      INTEGER_OPERATORS[INTEGER_OPERATORS_SIZE].integer = integer;
+      INTEGER_OPERATORS_SIZE++;
+    }
+}
 
-        Value *fn = (op->type == VALUE_SYMBOL)
-                      ? env_get (environment, op)
-                      : evaluate_expression (environment, op);
+static void
+quicken_primitive (CallSite *site, Value *primitive, Value *arguments)
+{
+  site->primitive = primitive;
+  site->integer = NULL;
 
-        ERROR_OUT (fn);
+  if (site->generic || arguments_length (arguments) != 2
+      || TYPE (CDDR (arguments)) != VALUE_NIL)
+    return;
 
-        return apply (environment, fn, args);
-      }
+  for (size_t i = 0; i < INTEGER_OPERATORS_SIZE; i++)
+    if (INTEGER_OPERATORS[i].primitive == AS_PRIMITIVE (primitive)->function)
+      site->integer = INTEGER_OPERATORS[i].integer;
+}
 
-    case VALUE_ERROR:
-    case VALUE_END_OF_FILE:
-      return expression;
+// The fast path of a quickened (op a b) form. The first call with anything
+// but two integers sends the site back to calling the primitive for good.
+static Value *
+call_integer (Environment *environment, CallSite *site, Value *arguments)
+{
+  Value *values[2];
 
-    default:
-      return val_error ("evaluate_expression: unknown VALUE type");
+  for (size_t i = 0; i < 2; i++, arguments = CDR (arguments))
+    {
+      values[i] = evaluate_expression (environment, CAR (arguments));
+      ERROR_OUT (values[i]);
     }
+
+  if (TYPE (values[0]) == VALUE_INTEGER && TYPE (values[1]) == VALUE_INTEGER)
+    return site->integer (INTEGER_VALUE (values[0]),
+                          INTEGER_VALUE (values[1]));
+
+  site->integer = NULL;
+  site->generic = true;
+  return call_primitive (site->primitive, values, 2);
 }
 
-int
-arguments_length (Value *arguments)
+// An expansion stays valid while its macro's name still refers to the same
+// macro where the form is evaluated. That cannot have changed if no macro
+// name has been rebound since it was last checked.
+static bool
+expansion_is_current (Environment *environment, CallSite *site, Value *op)
 {
-  int count = 0;
+  if (site->expansion_version == macro_version && !macro_names_shadowed)
+    return true;
 
-  while (arguments->type == VALUE_CONS)
+  if (call_site_lookup (site, environment, op) != site->macro)
+    return false;
+
+  site->expansion_version = macro_version;
+  return true;
+}
+
+// Anything the cache cannot vouch for goes through env_get.
+Value *
+call_site_lookup (CallSite *site, Environment *environment, Value *symbol)
+{
+  Environment *start = environment;
+  for (int hops = site->hops; hops > 0 && start; hops--)
+    start = start->parent;
+
+  if (site->version == env_version && site->start == start)
+    return site->binding->value;
+
+  Binding *binding
+      = start ? env_get_cacheable_binding (start, symbol) : NULL;
+  if (!binding)
+    return env_get (environment, symbol);
+
+  site->version = env_version;
+  site->start = start;
+  site->binding = binding;
+
+  return binding->value;
+}
+
+Value *
+module_reference_get (Environment *environment, Value *reference)
+{
+  if (AS_MODULE_REFERENCE (reference)->binding
+      && AS_MODULE_REFERENCE (reference)->version == env_version)
+    return AS_MODULE_REFERENCE (reference)->binding->value;
+
+  Value *name = AS_MODULE_REFERENCE (reference)->module;
+  Value *symbol = AS_MODULE_REFERENCE (reference)->symbol;
+
+  Value *module = module_map_get (AS_SYMBOL (name)->name);
+  if (!module)
     {
-      count++;
-      arguments = CDR (arguments);
+      // have get-from-module load it, or say why it cannot
+      Value *value = evaluate_expression (
+          environment,
+          val_cons (CORE_SYMBOL (GET_FROM_MODULE),
+                    val_cons (name, val_cons (symbol, val_nil ()))));
+      ERROR_OUT (value);
+
+      module = module_map_get (AS_SYMBOL (name)->name);
+      if (!module)
+        return value;
     }
 
-  return count;
+  Binding *binding
+      = env_get_own_binding (AS_MODULE (module)->environment, symbol);
+  if (!binding)
+    return val_error ("get-from-module: %s does not export %s",
+                      AS_SYMBOL (name)->name, AS_SYMBOL (symbol)->name);
+
+  AS_MODULE_REFERENCE (reference)->version = env_version;
+  AS_MODULE_REFERENCE (reference)->binding = binding;
+
+  return binding->value;
+}
+
+Compiled *
+closure_compiled (Value *closure)
+{
+  if (!AS_CLOSURE (closure)->compiled)
+    {
+      Compiled *compiled = GC_malloc (sizeof (Compiled));
+      memset (compiled, 0, sizeof (Compiled));
+      compiled->frame_size
+          = parameters_count (AS_CLOSURE (closure)->parameters);
+      AS_CLOSURE (closure)->compiled = compiled;
+    }
+
+  return AS_CLOSURE (closure)->compiled;
 }
 
 Value *
 macro_expand_expression (Environment *environment, Value *expr)
 {
-  if (expr->type != VALUE_CONS)
+  if (TYPE (expr) != VALUE_CONS)
     return expr;
 
   Value *head = CAR (expr);
-  if (head->type != VALUE_SYMBOL)
+  if (TYPE (head) != VALUE_SYMBOL)
     return expr;
 
   Value *macro = env_get (environment, head);
   ERROR_OUT (macro);
 
-  if (macro->type != VALUE_MACRO)
+  if (TYPE (macro) != VALUE_MACRO)
     return expr;
 
-  Environment *frame = env_init (macro->as.CLOSURE.environment);
+  return expand_macro (macro, expr);
+}
 
-  Value *err
-      = bind_macro_arguments (frame, macro->as.CLOSURE.parameters, CDR (expr));
+static Value *
+expand_macro (Value *macro, Value *expression)
+{
+  Environment *frame
+      = env_init_frame (AS_CLOSURE (macro)->environment,
+                        parameters_count (AS_CLOSURE (macro)->parameters));
+
+  Value *err = bind_macro_arguments (frame, AS_CLOSURE (macro)->parameters,
+                                     code_to_data (CDR (expression)));
   ERROR_OUT (err);
 
   Value *result = val_nil ();
-  for (Value *body = macro->as.CLOSURE.body; body->type == VALUE_CONS;
+  for (Value *body = AS_CLOSURE (macro)->body; TYPE (body) == VALUE_CONS;
        body = CDR (body))
     {
       result = evaluate_expression (frame, CAR (body));
@@ -104,29 +395,68 @@ macro_expand_expression (Environment *environment, Value *expr)
 Value *
 apply (Environment *call_env, Value *function, Value *arguments)
 {
-  if (function->type == VALUE_BUILTIN)
-    return function->as.BUILTIN (call_env, arguments);
+  if (TYPE (function) == VALUE_BUILTIN)
+    return eval_trampoline (
+        AS_BUILTIN (function)->function (call_env, arguments));
 
-  if (function->type == VALUE_LAMBDA)
+  if (TYPE (function) == VALUE_PRIMITIVE)
+    return apply_primitive (call_env, function, arguments);
+
+  if (TYPE (function) == VALUE_LAMBDA)
     {
-      Environment *frame = env_init (function->as.CLOSURE.environment);
+      Environment *frame;
+      Value *last = enter_lambda (call_env, function, arguments, &frame);
+      return evaluate_expression (frame, last);
+    }
 
-      Value *err = bind_arguments (call_env, frame,
-                                 function->as.CLOSURE.parameters, arguments);
-      ERROR_OUT (err);
+  return val_error ("attempt to call non-function");
+}
 
-      Value *result = val_nil ();
-      for (Value *body = function->as.CLOSURE.body; body->type == VALUE_CONS;
-           body = CDR (body))
-        {
-          result = evaluate_expression (frame, CAR (body));
-          ERROR_OUT (result);
-        }
+// Bind arguments in a new frame for function and evaluate all of its body
+// but the last form, which is returned for the caller to evaluate in *frame
+// (an error value evaluates to itself, so failures can be returned as is).
+static Value *
+enter_lambda (Environment *call_env, Value *function, Value *arguments,
+              Environment **frame)
+{
+  ClosureValue *closure = AS_CLOSURE (function);
+  *frame = env_init_frame (closure->environment,
+                           parameters_count (closure->parameters));
+
+  Value *err
+      = bind_arguments (call_env, *frame, closure->parameters, arguments);
+  ERROR_OUT (err);
+
+  Value *body = closure->body;
+  if (TYPE (body) != VALUE_CONS)
+    return val_nil ();
+
+  for (; TYPE (CDR (body)) == VALUE_CONS; body = CDR (body))
+    {
+      Value *result = evaluate_expression (*frame, CAR (body));
+      ERROR_OUT (result);
+    }
+
+  return CAR (body);
+}
+
+// number of bindings a call frame needs for its parameters, counting the
+// rest parameter as one
+static size_t
+parameters_count (Value *parameters)
+{
+  size_t count = 0;
 
-      return result;
+  while (TYPE (parameters) == VALUE_CONS)
+    {
+      count++;
+      parameters = CDR (parameters);
     }
 
-  return val_error ("attempt to call non-function");
+  if (TYPE (parameters) == VALUE_SYMBOL)
+    count++;
+
+  return count;
 }
 
 static Value *
@@ -136,31 +466,31 @@ bind_arguments (Environment *call_env, Environment *frame, Value *parameters, Va
   Value *args = arguments;
 
   /* fixed parameters */
-  while (params->type == VALUE_CONS)
+  while (TYPE (params) == VALUE_CONS)
     {
-      if (args->type != VALUE_CONS)
+      if (TYPE (args) != VALUE_CONS)
         return val_error ("lambda: too few arguments");
 
       Value *param = CAR (params);
-      if (param->type != VALUE_SYMBOL)
+      if (TYPE (param) != VALUE_SYMBOL)
         return val_error ("lambda parameter must be symbol");
 
       Value *value = evaluate_expression (call_env, CAR (args));
       ERROR_OUT (value);
 
-      env_set (frame, param, value, param->meta);
+      env_set (frame, param, value, value_meta (param));
 
       params = CDR (params);
       args = CDR (args);
     }
 
   /* rest parameter */
-  if (params->type == VALUE_SYMBOL)
+  if (TYPE (params) == VALUE_SYMBOL)
     {
       Value *list = val_nil ();
       Value *tail = NULL;
 
-      while (args->type == VALUE_CONS)
+      while (TYPE (args) == VALUE_CONS)
         {
           Value *value = evaluate_expression (call_env, CAR (args));
           ERROR_OUT (value);
@@ -169,20 +499,216 @@ bind_arguments (Environment *call_env, Environment *frame, Value *parameters, Va
           if (IS_NULL (list))
             list = cell;
           else
-            tail->as.CONS.CDR = cell;
+            AS_CONS (tail)->CDR = cell;
 
           tail = cell;
           args = CDR (args);
         }
 
-      env_set (frame, params, list, params->meta);
+      env_set (frame, params, list, value_meta (params));
+      return val_nil ();
+    }
+
+  if (TYPE (params) != VALUE_NIL)
+    return val_error ("lambda: invalid parameter list");
+
+  if (TYPE (args) != VALUE_NIL)
+    return val_error ("lambda: too many arguments");
+
+  return val_nil ();
+}
+
+static const Meta META_ARGUMENTS
+    = { .filename = "<arguments>", .line_number = 0 };
+
+// ARGUMENT_LISTS[n] is the argument list handed to a builtin called with n
+// values: (a0 a1 ...) as VALUE_LOCAL references into slots 0..n-1 of the
+// arguments frame, so evaluating them just reads the values back.
+static Value **ARGUMENT_LISTS = NULL;
+static size_t ARGUMENT_LISTS_SIZE = 0;
+
+// spare arguments frame, NULL while a builtin is using it
+static Environment *ARGUMENTS_FRAME = NULL;
+
+static Value *
+argument_list (size_t argc)
+{
+  if (argc >= ARGUMENT_LISTS_SIZE)
+    {
+      size_t size = ARGUMENT_LISTS_SIZE ? ARGUMENT_LISTS_SIZE : 8;
+      while (size <= argc)
+        size *= 2;
+
+      Value **lists = GC_malloc (size * sizeof (Value *));
+      memset (lists, 0, size * sizeof (Value *));
+      memcpy (lists, ARGUMENT_LISTS, ARGUMENT_LISTS_SIZE * sizeof (Value *));
+
+      ARGUMENT_LISTS = lists;
+      ARGUMENT_LISTS_SIZE = size;
+    }
+
+  if (!ARGUMENT_LISTS[argc])
+    {
+      Value *list = val_nil ();
+      for (size_t i = argc; i-- > 0;)
+        {
+          char name[48];
+          snprintf (name, sizeof (name), "#<argument %zu>", i);
+          list = val_cons (
+              val_local (val_symbol (name, META_ARGUMENTS), 0, i), list);
+        }
+
+      ARGUMENT_LISTS[argc] = list;
+    }
+
+  return ARGUMENT_LISTS[argc];
+}
+
+// Builtins take their arguments unevaluated, so the values are put in a
+// frame of their own and the builtin gets references to them to evaluate.
+// Ordinary builtins do not keep their environment around, which lets calls
+// reuse the same frame; only a builtin called while another one still
+// holds it gets a new one.
+Value *
+call_builtin (Environment *environment, Value *builtin, Value **arguments,
+              size_t argc)
+{
+  Environment *frame = ARGUMENTS_FRAME;
+  ARGUMENTS_FRAME = NULL;
+
+  if (!frame || frame->bindings_capacity < argc)
+    frame = env_init_frame (NULL, argc > ENV_INITIAL_CAPACITY
+                                      ? argc
+                                      : ENV_INITIAL_CAPACITY);
+
+  Value *list = argument_list (argc);
+
+  Value *reference = list;
+  for (size_t i = 0; i < argc; i++, reference = CDR (reference))
+    {
+      frame->bindings[i].key = AS_LOCAL (CAR (reference))->symbol;
+      frame->bindings[i].value = arguments[i];
+    }
+
+  frame->bindings_size = argc;
+  frame->parent = environment;
+
+  Value *result
+      = eval_trampoline (AS_BUILTIN (builtin)->function (frame, list));
+
+  ARGUMENTS_FRAME = frame;
+  return result;
+}
+
+// nil when primitive takes argc arguments, the error a call with argc
+// arguments evaluates to otherwise
+static Value *
+check_arity (Value *primitive, size_t argc)
+{
+  int min = AS_PRIMITIVE (primitive)->min_arguments;
+  int max = AS_PRIMITIVE (primitive)->max_arguments;
+
+  if ((int)argc >= min && (max == PRIMITIVE_VARIADIC || (int)argc <= max))
+    return val_nil ();
+
+  const char *name = AS_PRIMITIVE (primitive)->name;
+  if (min == max)
+    return val_error ("%s: expects exactly %d argument%s", name, min,
+                      min == 1 ? "" : "s");
+  if (max == PRIMITIVE_VARIADIC)
+    return val_error ("%s: expects at least %d argument%s", name, min,
+                      min == 1 ? "" : "s");
+  return val_error ("%s: expects %d to %d arguments", name, min, max);
+}
+
+Value *
+call_primitive (Value *primitive, Value **arguments, size_t argc)
+{
+  Value *err = check_arity (primitive, argc);
+  ERROR_OUT (err);
+
+  for (size_t i = 0; i < argc; i++)
+    ERROR_OUT (arguments[i]);
+
+  return AS_PRIMITIVE (primitive)->function (argc, arguments);
+}
+
+#define INLINE_ARGUMENTS 8
+
+// Evaluate the argument list of a call of primitive left to right, stopping
+// at the first error, and call it. Kept out of evaluate_expression so the
+// argument buffer does not weigh on every level of its recursion.
+__attribute__ ((noinline)) static Value *
+apply_primitive (Environment *environment, Value *primitive,
+                 Value *arguments)
+{
+  size_t argc = 0;
+  Value *rest = arguments;
+  for (; TYPE (rest) == VALUE_CONS; rest = CDR (rest))
+    argc++;
+
+  if (TYPE (rest) != VALUE_NIL)
+    return val_error ("%s: improper argument list",
+                      AS_PRIMITIVE (primitive)->name);
+
+  Value *err = check_arity (primitive, argc);
+  ERROR_OUT (err);
+
+  Value *buffer[INLINE_ARGUMENTS];
+  Value **values = argc <= INLINE_ARGUMENTS
+                       ? buffer
+                       : GC_malloc (argc * sizeof (Value *));
+
+  for (size_t i = 0; i < argc; i++, arguments = CDR (arguments))
+    {
+      values[i] = evaluate_expression (environment, CAR (arguments));
+      ERROR_OUT (values[i]);
+    }
+
+  return AS_PRIMITIVE (primitive)->function (argc, values);
+}
+
+// Same checks, in the same order, as bind_arguments, but with the arguments
+// already evaluated.
+Value *
+bind_values (Environment *frame, Value *parameters, Value **arguments,
+             size_t argc)
+{
+  size_t i = 0;
+
+  for (; TYPE (parameters) == VALUE_CONS; parameters = CDR (parameters), i++)
+    {
+      if (i >= argc)
+        return val_error ("lambda: too few arguments");
+
+      Value *param = CAR (parameters);
+      if (TYPE (param) != VALUE_SYMBOL)
+        return val_error ("lambda parameter must be symbol");
+
+      if (TYPE (arguments[i]) == VALUE_ERROR)
+        return arguments[i];
+
+      env_set (frame, param, arguments[i], value_meta (param));
+    }
+
+  if (TYPE (parameters) == VALUE_SYMBOL)
+    {
+      for (size_t j = i; j < argc; j++)
+        if (TYPE (arguments[j]) == VALUE_ERROR)
+          return arguments[j];
+
+      Value *list = val_nil ();
+      for (size_t j = argc; j > i; j--)
+        list = val_cons (arguments[j - 1], list);
+
+      env_set (frame, parameters, list, value_meta (parameters));
       return val_nil ();
     }
 
-  if (params->type != VALUE_NIL)
+  if (TYPE (parameters) != VALUE_NIL)
     return val_error ("lambda: invalid parameter list");
 
-  if (args->type != VALUE_NIL)
+  if (i < argc)
     return val_error ("lambda: too many arguments");
 
   return val_nil ();
@@ -194,30 +720,30 @@ bind_macro_arguments (Environment *frame, Value *parameters, Value *arguments)
   Value *params = parameters;
   Value *args = arguments;
 
-  while (params->type == VALUE_CONS)
+  while (TYPE (params) == VALUE_CONS)
     {
-      if (args->type != VALUE_CONS)
+      if (TYPE (args) != VALUE_CONS)
         return val_error ("macro: too few arguments");
 
       Value *param = CAR (params);
-      if (param->type != VALUE_SYMBOL)
+      if (TYPE (param) != VALUE_SYMBOL)
         return val_error ("macro parameter must be symbol");
 
-      env_set (frame, param, CAR (args), param->meta);
+      env_set (frame, param, CAR (args), value_meta (param));
       params = CDR (params);
       args = CDR (args);
     }
 
-  if (params->type == VALUE_SYMBOL)
+  if (TYPE (params) == VALUE_SYMBOL)
     {
-      env_set (frame, params, args, params->meta);
+      env_set (frame, params, args, value_meta (params));
       return val_nil ();
     }
 
-  if (params->type != VALUE_NIL)
+  if (TYPE (params) != VALUE_NIL)
     return val_error ("macro: invalid parameter list");
 
-  if (args->type != VALUE_NIL)
+  if (TYPE (args) != VALUE_NIL)
     return val_error ("macro: too many arguments");
 
   return val_nil ();
@@ -0,0 +1,280 @@
+#include "core/expand.h"
+#include "core/eval.h"
+#include "core/quasiquote.h"
+#include "core/special_form.h"
+#include "core/symbol_map.h"
+
+#include <stdbool.h>
+
+static Value *expand (Environment *environment, Value *locals,
+                      Value *expression);
+
+static bool
+is_member (Value *list, Value *symbol)
+{
+  for (; TYPE (list) == VALUE_CONS; list = CDR (list))
+    if (CAR (list) == symbol)
+      return true;
+
+  return false;
+}
+
+// locals holds the names bound by enclosing lambdas and lets; a call whose
+// head is one of them is never a macro call
+static Value *
+bind_parameters (Value *locals, Value *parameters)
+{
+  for (; TYPE (parameters) == VALUE_CONS; parameters = CDR (parameters))
+    locals = val_cons (CAR (parameters), locals);
+
+  if (TYPE (parameters) == VALUE_SYMBOL)
+    locals = val_cons (parameters, locals);
+
+  return locals;
+}
+
+// cell itself when it is code already and neither half changed, a fresh
+// code cons otherwise: whatever else the expander is given may be data the
+// program can still reach
+static Value *
+update (Value *cell, Value *car, Value *cdr)
+{
+  if (cell->flags & VALUE_FLAG_CODE && CAR (cell) == car && CDR (cell) == cdr)
+    return cell;
+
+  return val_code (car, cdr);
+}
+
+static Value *
+expand_list (Environment *environment, Value *locals, Value *list)
+{
+  if (TYPE (list) != VALUE_CONS)
+    return list;
+
+  Value *car = expand (environment, locals, CAR (list));
+  Value *cdr = expand_list (environment, locals, CDR (list));
+
+  return update (list, car, cdr);
+}
+
+static Value *
+expand_lambda (Environment *environment, Value *locals, Value *arguments)
+{
+  if (TYPE (arguments) != VALUE_CONS)
+    return arguments;
+
+  Value *body = expand_list (environment,
+                             bind_parameters (locals, CAR (arguments)),
+                             CDR (arguments));
+
+  return update (arguments, CAR (arguments), body);
+}
+
+static Value *
+expand_let (Environment *environment, Value *locals, Value *arguments)
+{
+  if (TYPE (arguments) != VALUE_CONS)
+    return arguments;
+
+  Value *bindings = CAR (arguments);
+  Value *expanded = val_nil ();
+  Value *tail = NULL;
+  bool changed = false;
+
+  for (; TYPE (bindings) == VALUE_CONS; bindings = CDR (bindings))
+    {
+      Value *binding = CAR (bindings);
+      if (TYPE (binding) == VALUE_CONS)
+        {
+          Value *rest = expand_list (environment, locals, CDR (binding));
+          Value *updated = update (binding, CAR (binding), rest);
+
+          if (updated != binding)
+            {
+              binding = updated;
+              changed = true;
+            }
+
+          locals = val_cons (CAR (binding), locals);
+        }
+
+      Value *cell = val_code (binding, val_nil ());
+      if (tail)
+        CDR (tail) = cell;
+      else
+        expanded = cell;
+      tail = cell;
+    }
+
+  if (!changed)
+    expanded = CAR (arguments);
+  else if (tail)
+    CDR (tail) = bindings;
+
+  Value *body = expand_list (environment, locals, CDR (arguments));
+
+  return update (arguments, expanded, body);
+}
+
+static Value *
+expand (Environment *environment, Value *locals, Value *expression)
+{
+  while (TYPE (expression) == VALUE_CONS)
+    {
+      Value *head = CAR (expression);
+      if (TYPE (head) != VALUE_SYMBOL || is_member (locals, head))
+        break;
+
+      Binding *binding = env_get_binding (environment, head);
+      if (!binding || TYPE (binding->value) != VALUE_MACRO)
+        break;
+
+      // a call that fails to expand is left for the evaluator, so the error
+      // shows up when (and if) the form is evaluated
+      Value *expanded = macro_expand_expression (environment, expression);
+      if (TYPE (expanded) == VALUE_ERROR)
+        return update (expression, head, CDR (expression));
+
+      expression = expanded;
+    }
+
+  if (TYPE (expression) != VALUE_CONS)
+    return expression;
+
+  Value *head = CAR (expression);
+  Value *arguments = CDR (expression);
+  Value *expanded;
+
+  SpecialForm form = is_member (locals, head) ? SPECIAL_NONE
+                                              : special_form (head);
+  switch (form)
+    {
+    case SPECIAL_RAW:
+      // module/symbol references are resolved once, see
+      // module_reference_get
+      if (head == CORE_SYMBOL (GET_FROM_MODULE)
+          && arguments_length (arguments) == 2
+          && TYPE (CAR (arguments)) == VALUE_SYMBOL
+          && TYPE (CADR (arguments)) == VALUE_SYMBOL)
+        return val_module_reference (CAR (arguments), CADR (arguments));
+      return update (expression, head, arguments);
+
+    // only the form itself is code, its arguments are data
+    case SPECIAL_QUOTE:
+    case SPECIAL_MACRO:
+    case SPECIAL_DEFMACRO:
+      return update (expression, head, arguments);
+
+    case SPECIAL_QUASIQUOTE:
+      // malformed ones are left for the builtin to complain about
+      if (arguments_length (arguments) != 1)
+        return update (expression, head, arguments);
+
+      expanded = expand_quasiquote (CAR (arguments), 1);
+      if (TYPE (expanded) == VALUE_ERROR)
+        return update (expression, head, arguments);
+
+      return expand (environment, locals, expanded);
+
+    case SPECIAL_LAMBDA:
+      expanded = expand_lambda (environment, locals, arguments);
+      break;
+
+    case SPECIAL_DEFINE:
+      if (TYPE (arguments) == VALUE_CONS && TYPE (CAR (arguments)) == VALUE_CONS)
+        {
+          Value *body = expand_list (
+              environment, bind_parameters (locals, CDAR (arguments)),
+              CDR (arguments));
+          expanded = update (arguments, CAR (arguments), body);
+        }
+      else if (TYPE (arguments) == VALUE_CONS)
+        {
+          Value *rest = expand_list (environment, locals, CDR (arguments));
+          expanded = update (arguments, CAR (arguments), rest);
+        }
+      else
+        expanded = arguments;
+      break;
+
+    case SPECIAL_SET:
+      if (TYPE (arguments) == VALUE_CONS)
+        {
+          Value *rest = expand_list (environment, locals, CDR (arguments));
+          expanded = update (arguments, CAR (arguments), rest);
+        }
+      else
+        expanded = arguments;
+      break;
+
+    case SPECIAL_LET:
+    case SPECIAL_LET_STAR:
+      expanded = expand_let (environment, locals, arguments);
+      break;
+
+    default:
+      {
+        Value *new_head = expand (environment, locals, head);
+        expanded = expand_list (environment, locals, arguments);
+        return update (expression, new_head, expanded);
+      }
+    }
+
+  return update (expression, head, expanded);
+}
+
+Value *
+code_to_data (Value *code)
+{
+  switch (TYPE (code))
+    {
+    case VALUE_LOCAL:
+      return AS_LOCAL (code)->symbol;
+
+    case VALUE_MODULE_REFERENCE:
+      return val_cons (
+          CORE_SYMBOL (GET_FROM_MODULE),
+          val_cons (AS_MODULE_REFERENCE (code)->module,
+                    val_cons (AS_MODULE_REFERENCE (code)->symbol,
+                              val_nil ())));
+
+    case VALUE_CONS:
+      // the expander never puts code inside data
+      if (!(code->flags & VALUE_FLAG_CODE))
+        return code;
+      return val_cons (code_to_data (CAR (code)), code_to_data (CDR (code)));
+
+    default:
+      return code;
+    }
+}
+
+Value *
+macro_expand_all (Environment *environment, Value *expression)
+{
+  return expand (environment, val_nil (), expression);
+}
+
+Value *
+macro_expand_body (Environment *environment, Value *parameters, Value *body)
+{
+  return expand_list (environment, bind_parameters (val_nil (), parameters),
+                      body);
+}
+
+Value *
+evaluate_expanded (Environment *environment, Reader *reader,
+                   Value *(*evaluate) (Environment *, Value *))
+{
+  Value *result = val_nil ();
+
+  Value *form;
+  while ((form = reader_next (reader)))
+    {
+      ERROR_OUT (form);
+      result = evaluate (environment, macro_expand_all (environment, form));
+      ERROR_OUT (result);
+    }
+
+  return result;
+}
@@ -0,0 +1,886 @@
+#include "core/image.h"
+
+#include <gc/gc.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "core/encoding.h"
+#include "core/eval.h"
+#include "core/mapped_file.h"
+#include "core/module_map.h"
+#include "core/symbol_map.h"
+
+#define IMAGE_MAGIC 0x4945444fu // "ODEI" read as a little endian word
+
+// An image is a header, the table of the filenames source locations refer
+// to, the roots, and then every saved object in turn: a kind byte (the
+// value's type, or one of the kinds below) and its fields, with pointers
+// written as references (see put_value). Objects are loaded in two passes,
+// the first allocating them all and the second filling in the references,
+// which can point forwards as well as backwards. Values that need not be
+// made by their constructors (interned, registered, ...) are laid out in one
+// block, like a heap mapped back in, and their strings in another.
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+} Header;
+
+enum
+{
+  OBJECT_ENVIRONMENT = VALUE_TAIL_CALL + 1,
+  OBJECT_CALL_SITE,
+};
+
+typedef struct
+{
+  Encoder out;
+
+  // every object found so far, in the order they are written; an object's
+  // id is its position + 1
+  void **objects;
+  unsigned char *kinds;
+  size_t size;
+  size_t capacity;
+
+  size_t *index; // open-addressed object -> id, 0 marks empty
+  size_t index_capacity;
+
+  const char **filenames;
+  size_t filenames_size;
+  size_t filenames_capacity;
+
+  size_t region;  // bytes of the block objects are laid out in
+  size_t strings; // and of the one for their strings
+
+  Environment *builtins; // fresh ones, to find the names of those saved
+  Value *error;
+} ImageWriter;
+
+static size_t
+pointer_hash (void *pointer)
+{
+  return (size_t)(((uintptr_t)pointer >> 4) * 0x9E3779B97F4A7C15ull);
+}
+
+static void
+resize_index (ImageWriter *writer, size_t capacity)
+{
+  writer->index = GC_malloc_atomic (capacity * sizeof (size_t));
+  memset (writer->index, 0, capacity * sizeof (size_t));
+  writer->index_capacity = capacity;
+
+  for (size_t i = 0; i < writer->size; i++)
+    {
+      size_t slot = pointer_hash (writer->objects[i]) & (capacity - 1);
+      while (writer->index[slot])
+        slot = (slot + 1) & (capacity - 1);
+      writer->index[slot] = i + 1;
+    }
+}
+
+// The id of object, queuing it to be written if it is new
+static size_t
+object_id (ImageWriter *writer, int kind, void *object)
+{
+  if (2 * (writer->size + 1) > writer->index_capacity)
+    resize_index (writer, writer->index_capacity ? writer->index_capacity * 2
+                                                 : 1024);
+
+  size_t mask = writer->index_capacity - 1;
+  size_t slot = pointer_hash (object) & mask;
+  for (; writer->index[slot]; slot = (slot + 1) & mask)
+    if (writer->objects[writer->index[slot] - 1] == object)
+      return writer->index[slot];
+
+  if (writer->size == writer->capacity)
+    {
+      size_t capacity = writer->capacity ? writer->capacity * 2 : 1024;
+
+      void **objects = GC_malloc (capacity * sizeof (void *));
+      unsigned char *kinds = GC_malloc_atomic (capacity);
+      if (writer->size)
+        {
+          memcpy (objects, writer->objects, writer->size * sizeof (void *));
+          memcpy (kinds, writer->kinds, writer->size);
+        }
+
+      writer->objects = objects;
+      writer->kinds = kinds;
+      writer->capacity = capacity;
+    }
+
+  writer->objects[writer->size] = object;
+  writer->kinds[writer->size] = kind;
+  writer->index[slot] = ++writer->size;
+  return writer->size;
+}
+
+// References are 0 for NULL, id << 1 for objects and, since fixnums are no
+// objects, the zigzag encoded number << 1 | 1 for them
+static void
+put_object (ImageWriter *writer, int kind, void *object)
+{
+  encoder_put_unsigned (&writer->out,
+                        object ? object_id (writer, kind, object) << 1 : 0);
+}
+
+static void
+put_value (ImageWriter *writer, Value *value)
+{
+  if (value && IS_FIXNUM (value))
+    {
+      uint64_t bits = INTEGER_VALUE (value);
+      encoder_put_unsigned (&writer->out,
+                            ((bits << 1) ^ -(bits >> 63)) << 1 | 1);
+      return;
+    }
+
+  put_object (writer, value ? (int)TYPE (value) : 0, value);
+}
+
+static void
+put_meta (ImageWriter *writer, Meta meta)
+{
+  size_t i = 0;
+  if (meta.filename)
+    {
+      while (i < writer->filenames_size
+             && strcmp (writer->filenames[i], meta.filename) != 0)
+        i++;
+
+      if (i == writer->filenames_size)
+        {
+          if (writer->filenames_size == writer->filenames_capacity)
+            {
+              size_t capacity = writer->filenames_capacity
+                                    ? writer->filenames_capacity * 2
+                                    : 16;
+              const char **filenames = GC_malloc (capacity * sizeof (char *));
+              if (writer->filenames_size)
+                memcpy (filenames, writer->filenames,
+                        writer->filenames_size * sizeof (char *));
+              writer->filenames = filenames;
+              writer->filenames_capacity = capacity;
+            }
+          writer->filenames[writer->filenames_size++] = meta.filename;
+        }
+      i++;
+    }
+
+  encoder_put_unsigned (&writer->out, i); // 0 for none
+  encoder_put_signed (&writer->out, meta.line_number);
+}
+
+// The name builtin is registered under, NULL if it is not one of them
+static const char *
+builtin_name (ImageWriter *writer, Value *builtin)
+{
+  Environment *builtins = writer->builtins;
+
+  for (size_t i = 0; i < builtins->bindings_size; i++)
+    {
+      Value *value = builtins->bindings[i].value;
+      if (TYPE (value) != TYPE (builtin))
+        continue;
+
+      if (TYPE (builtin) == VALUE_BUILTIN
+              ? AS_BUILTIN (value)->function == AS_BUILTIN (builtin)->function
+              : AS_PRIMITIVE (value)->function
+                    == AS_PRIMITIVE (builtin)->function)
+        return AS_SYMBOL (builtins->bindings[i].key)->name;
+    }
+
+  return NULL;
+}
+
+static void
+write_object (ImageWriter *writer, size_t i)
+{
+  void *object = writer->objects[i];
+  int kind = writer->kinds[i];
+  Value *value = object;
+
+  encoder_put_byte (&writer->out, kind);
+
+  switch (kind)
+    {
+    case VALUE_NIL:
+      return;
+
+    case VALUE_SYMBOL:
+      encoder_put_string (&writer->out, AS_SYMBOL (value)->name);
+      encoder_put_unsigned (&writer->out, value->flags);
+      put_meta (writer, value_meta (value));
+      return;
+
+    case VALUE_INTEGER:
+      encoder_put_signed (&writer->out, AS_INTEGER (value)->value);
+      return;
+
+    case VALUE_FLOAT:
+      encoder_put (&writer->out, &AS_FLOAT (value)->value, sizeof (double));
+      return;
+
+    case VALUE_STRING:
+      encoder_put_string (&writer->out, AS_STRING (value)->value);
+      writer->region += sizeof (StringValue);
+      writer->strings += strlen (AS_STRING (value)->value) + 1;
+      return;
+
+    case VALUE_ERROR:
+      encoder_put_string (&writer->out, AS_ERROR (value)->MESSAGE);
+      return;
+
+    case VALUE_CONS:
+      encoder_put_unsigned (&writer->out, value->flags);
+      put_value (writer, CAR (value));
+      put_value (writer, CDR (value));
+      if (value->flags & VALUE_FLAG_CODE)
+        {
+          put_object (writer, OBJECT_CALL_SITE, AS_CODE (value)->SITE);
+          writer->region += sizeof (CodeValue);
+        }
+      else
+        writer->region += sizeof (ConsValue);
+      return;
+
+    case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
+      {
+        const char *name = builtin_name (writer, value);
+        if (!name)
+          {
+            writer->error = val_error ("image: %s is not a registered builtin",
+                                       kind == VALUE_PRIMITIVE
+                                           ? AS_PRIMITIVE (value)->name
+                                           : "a special form");
+            return;
+          }
+        encoder_put_string (&writer->out, name);
+        return;
+      }
+
+    case VALUE_LAMBDA:
+    case VALUE_MACRO:
+      put_object (writer, OBJECT_ENVIRONMENT, AS_CLOSURE (value)->environment);
+      put_value (writer, AS_CLOSURE (value)->parameters);
+      put_value (writer, AS_CLOSURE (value)->body);
+      writer->region += sizeof (ClosureValue);
+      return;
+
+    case VALUE_MODULE:
+      encoder_put_string (&writer->out, AS_MODULE (value)->name);
+      put_object (writer, OBJECT_ENVIRONMENT, AS_MODULE (value)->environment);
+      encoder_put_signed (&writer->out, AS_MODULE (value)->mtime.tv_sec);
+      encoder_put_unsigned (&writer->out, AS_MODULE (value)->mtime.tv_nsec);
+      encoder_put_unsigned (&writer->out, AS_MODULE (value)->size);
+      return;
+
+    case VALUE_LOCAL:
+      put_value (writer, AS_LOCAL (value)->symbol);
+      encoder_put_signed (&writer->out, AS_LOCAL (value)->depth);
+      encoder_put_signed (&writer->out, AS_LOCAL (value)->slot);
+      writer->region += sizeof (LocalValue);
+      return;
+
+    case VALUE_MODULE_REFERENCE:
+      // the exported binding is looked up again on first use
+      put_value (writer, AS_MODULE_REFERENCE (value)->module);
+      put_value (writer, AS_MODULE_REFERENCE (value)->symbol);
+      writer->region += sizeof (ModuleReferenceValue);
+      return;
+
+    case OBJECT_ENVIRONMENT:
+      {
+        Environment *environment = object;
+        put_object (writer, OBJECT_ENVIRONMENT, environment->parent);
+        encoder_put_byte (&writer->out, environment->is_frame);
+        encoder_put_unsigned (&writer->out, environment->bindings_size);
+
+        for (size_t slot = 0; slot < environment->bindings_size; slot++)
+          {
+            Binding *binding = &environment->bindings[slot];
+            put_value (writer, binding->key);
+            put_value (writer, binding->value);
+            put_meta (writer, binding->meta);
+            encoder_put_byte (&writer->out, binding->redefinable);
+          }
+        return;
+      }
+
+    case OBJECT_CALL_SITE:
+      {
+        CallSite *site = object;
+        encoder_put_signed (&writer->out, site->hops);
+        writer->region += sizeof (CallSite);
+        return;
+      }
+
+    default:
+      writer->error = val_error ("image: cannot save a value of type %d",
+                                 kind);
+      return;
+    }
+}
+
+static void
+add_module (const char *name, Value *module, void *data)
+{
+  (void)name;
+  object_id (data, VALUE_MODULE, module);
+}
+
+Value *
+image_dump (Environment *environment, const char *filename,
+            Set_Builtins_Function set_builtins)
+{
+  ImageWriter writer = { 0 };
+  writer.builtins = env_init (NULL);
+  set_builtins (writer.builtins);
+
+  // the roots get the first ids: the global environment, then the modules
+  object_id (&writer, OBJECT_ENVIRONMENT, environment);
+  module_map_for_each (add_module, &writer);
+  size_t modules = writer.size - 1;
+
+  for (size_t i = 0; i < writer.size && !writer.error; i++)
+    write_object (&writer, i);
+
+  if (writer.error)
+    return writer.error;
+
+  Encoder head = { 0 };
+  Header header = { .magic = IMAGE_MAGIC, .version = IMAGE_VERSION };
+  encoder_put (&head, &header, sizeof (header));
+  encoder_put_unsigned (&head, writer.size);
+  encoder_put_unsigned (&head, writer.region);
+  encoder_put_unsigned (&head, writer.strings);
+  encoder_put_unsigned (&head, modules);
+  encoder_put_byte (&head, macro_names_shadowed);
+
+  encoder_put_unsigned (&head, writer.filenames_size);
+  for (size_t i = 0; i < writer.filenames_size; i++)
+    encoder_put_string (&head, writer.filenames[i]);
+
+  // written under a temporary name and renamed, so a process starting at
+  // the same time never sees half an image
+  size_t length = strlen (filename) + 32;
+  char *temporary = GC_malloc_atomic (length);
+  snprintf (temporary, length, "%s.%ld", filename, (long)getpid ());
+
+  FILE *file = fopen (temporary, "wb");
+  if (!file)
+    return val_error ("image: cannot write %s", temporary);
+
+  bool written
+      = fwrite (head.bytes, 1, head.size, file) == head.size
+        && fwrite (writer.out.bytes, 1, writer.out.size, file)
+               == writer.out.size;
+
+  if (fclose (file) != 0 || !written || rename (temporary, filename) != 0)
+    {
+      unlink (temporary);
+      return val_error ("image: cannot write %s", filename);
+    }
+
+  return val_nil ();
+}
+
+typedef struct
+{
+  Decoder decoder;
+  bool fill; // second pass: references can be resolved
+
+  void **objects;
+  unsigned char *kinds;
+  size_t size;
+
+  char **filenames;
+  size_t filenames_size;
+
+  // what is left of the blocks objects and strings are laid out in
+  char *region;
+  size_t region_left;
+  char *strings;
+  size_t strings_left;
+
+  Environment *builtins; // what saved builtins are matched up with
+  Value *error;
+} ImageReader;
+
+static void *
+get_object (ImageReader *reader, int kind)
+{
+  uint64_t reference = decoder_get_unsigned (&reader->decoder);
+  if (!reader->fill || reference == 0)
+    return NULL;
+
+  uint64_t id = reference >> 1;
+  if (reference & 1 || id > reader->size || reader->kinds[id - 1] != kind)
+    {
+      reader->decoder.failed = true;
+      return NULL;
+    }
+
+  return reader->objects[id - 1];
+}
+
+static Value *
+get_value (ImageReader *reader)
+{
+  uint64_t reference = decoder_get_unsigned (&reader->decoder);
+  if (!reader->fill || reference == 0)
+    return NULL;
+
+  if (reference & 1)
+    {
+      uint64_t bits = reference >> 1;
+      return val_integer ((long)((bits >> 1) ^ -(bits & 1)));
+    }
+
+  uint64_t id = reference >> 1;
+  if (id > reader->size || reader->kinds[id - 1] >= OBJECT_ENVIRONMENT)
+    {
+      reader->decoder.failed = true;
+      return NULL;
+    }
+
+  return reader->objects[id - 1];
+}
+
+static Meta
+get_meta (ImageReader *reader)
+{
+  uint64_t filename = decoder_get_unsigned (&reader->decoder);
+  int line = decoder_get_signed (&reader->decoder);
+
+  if (filename > reader->filenames_size)
+    {
+      reader->decoder.failed = true;
+      filename = 0;
+    }
+
+  return (Meta){ .filename = filename ? reader->filenames[filename - 1] : NULL,
+                 .line_number = line };
+}
+
+// The next size bytes of block, NULL if the image asks for more than it
+// said it would
+static void *
+carve (ImageReader *reader, char **block, size_t *left, size_t size)
+{
+  if (size > *left)
+    {
+      reader->decoder.failed = true;
+      return NULL;
+    }
+
+  void *bytes = *block;
+  *block += size;
+  *left -= size;
+  return bytes;
+}
+
+// Whatever an object can take from the region
+typedef union
+{
+  CodeValue code;
+  ClosureValue closure;
+  LocalValue local;
+  ModuleReferenceValue reference;
+  CallSite site;
+} Carved;
+
+static Value *
+carve_value (ImageReader *reader, ValueType type, size_t size)
+{
+  Value *value = carve (reader, &reader->region, &reader->region_left, size);
+  if (value)
+    value->type = type;
+  return value;
+}
+
+// A string in the image, not copied
+static const char *
+get_slice (ImageReader *reader, size_t *length)
+{
+  *length = decoder_get_unsigned (&reader->decoder);
+  return (const char *)decoder_get (&reader->decoder, *length);
+}
+
+static Value *
+find_builtin (ImageReader *reader, int kind, const char *name, size_t length)
+{
+  Value *symbol
+      = symbol_map_get (name, length, symbol_map_hash (name, length));
+  Binding *binding
+      = symbol ? env_get_binding (reader->builtins, symbol) : NULL;
+
+  if (!binding || TYPE (binding->value) != kind)
+    {
+      reader->error = val_error ("image: unknown builtin %.*s", (int)length,
+                                 name);
+      return NULL;
+    }
+
+  return binding->value;
+}
+
+// Read the object with the given position: allocate it in the first pass,
+// fill in its references in the second
+static void
+read_object (ImageReader *reader, size_t i)
+{
+  Decoder *decoder = &reader->decoder;
+  bool fill = reader->fill;
+
+  int kind = decoder_get_byte (decoder);
+  if (!fill)
+    reader->kinds[i] = kind;
+
+  void **object = &reader->objects[i];
+  Value *value = *object;
+
+  switch (kind)
+    {
+    case VALUE_NIL:
+      if (!fill)
+        *object = val_nil ();
+      return;
+
+    case VALUE_SYMBOL:
+      {
+        size_t length;
+        const char *name = get_slice (reader, &length);
+        unsigned flags = decoder_get_unsigned (decoder);
+        Meta meta = get_meta (reader);
+
+        if (!fill && !decoder->failed)
+          {
+            Value *symbol = val_symbol_slice (name, length, meta);
+            symbol->flags |= flags;
+            *object = symbol;
+          }
+        return;
+      }
+
+    case VALUE_INTEGER:
+      {
+        long integer = decoder_get_signed (decoder);
+        if (!fill)
+          *object = val_integer (integer);
+        return;
+      }
+
+    case VALUE_FLOAT:
+      {
+        const unsigned char *bytes = decoder_get (decoder, sizeof (double));
+        if (!fill && bytes)
+          {
+            double number;
+            memcpy (&number, bytes, sizeof (double));
+            *object = val_float (number);
+          }
+        return;
+      }
+
+    case VALUE_STRING:
+    case VALUE_ERROR:
+      {
+        size_t length;
+        const char *text = get_slice (reader, &length);
+        if (fill || !text)
+          return;
+
+        if (kind == VALUE_ERROR)
+          {
+            *object = val_error ("%.*s", (int)length, text);
+            return;
+          }
+
+        Value *string
+            = carve_value (reader, VALUE_STRING, sizeof (StringValue));
+        char *chars = carve (reader, &reader->strings, &reader->strings_left,
+                             length + 1);
+        if (string && chars)
+          {
+            memcpy (chars, text, length);
+            chars[length] = '\0';
+            AS_STRING (string)->value = chars;
+          }
+        *object = string;
+        return;
+      }
+
+    case VALUE_CONS:
+      {
+        unsigned flags = decoder_get_unsigned (decoder);
+        Value *car = get_value (reader);
+        Value *cdr = get_value (reader);
+        bool code = flags & VALUE_FLAG_CODE;
+        CallSite *site = code ? get_object (reader, OBJECT_CALL_SITE) : NULL;
+
+        if (!fill)
+          *object = carve_value (reader, VALUE_CONS,
+                                 code ? sizeof (CodeValue)
+                                      : sizeof (ConsValue));
+        else
+          {
+            value->flags = flags;
+            CAR (value) = car;
+            CDR (value) = cdr;
+            if (code)
+              AS_CODE (value)->SITE = site;
+          }
+        return;
+      }
+
+    case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
+      {
+        size_t length;
+        const char *name = get_slice (reader, &length);
+        if (!fill && name)
+          *object = find_builtin (reader, kind, name, length);
+        return;
+      }
+
+    case VALUE_LAMBDA:
+    case VALUE_MACRO:
+      {
+        Environment *environment = get_object (reader, OBJECT_ENVIRONMENT);
+        Value *parameters = get_value (reader);
+        Value *body = get_value (reader);
+
+        if (!fill)
+          *object = carve_value (reader, kind, sizeof (ClosureValue));
+        else
+          {
+            AS_CLOSURE (value)->environment = environment;
+            AS_CLOSURE (value)->parameters = parameters;
+            AS_CLOSURE (value)->body = body;
+          }
+        return;
+      }
+
+    case VALUE_MODULE:
+      {
+        size_t length;
+        const char *name = get_slice (reader, &length);
+        Environment *environment = get_object (reader, OBJECT_ENVIRONMENT);
+        struct timespec mtime;
+        mtime.tv_sec = decoder_get_signed (decoder);
+        mtime.tv_nsec = decoder_get_unsigned (decoder);
+        size_t size = decoder_get_unsigned (decoder);
+
+        if (!fill && name)
+          *object = val_module (GC_strndup (name, length), NULL);
+        else if (fill)
+          {
+            AS_MODULE (value)->environment = environment;
+            AS_MODULE (value)->mtime = mtime;
+            AS_MODULE (value)->size = size;
+          }
+        return;
+      }
+
+    case VALUE_LOCAL:
+      {
+        Value *symbol = get_value (reader);
+        int depth = decoder_get_signed (decoder);
+        int slot = decoder_get_signed (decoder);
+
+        if (!fill)
+          {
+            Value *local
+                = carve_value (reader, VALUE_LOCAL, sizeof (LocalValue));
+            if (local)
+              {
+                AS_LOCAL (local)->depth = depth;
+                AS_LOCAL (local)->slot = slot;
+              }
+            *object = local;
+          }
+        else
+          AS_LOCAL (value)->symbol = symbol;
+        return;
+      }
+
+    case VALUE_MODULE_REFERENCE:
+      {
+        Value *module = get_value (reader);
+        Value *symbol = get_value (reader);
+
+        if (!fill)
+          *object = carve_value (reader, VALUE_MODULE_REFERENCE,
+                                 sizeof (ModuleReferenceValue));
+        else
+          {
+            AS_MODULE_REFERENCE (value)->module = module;
+            AS_MODULE_REFERENCE (value)->symbol = symbol;
+          }
+        return;
+      }
+
+    case OBJECT_ENVIRONMENT:
+      {
+        Environment *parent = get_object (reader, OBJECT_ENVIRONMENT);
+        bool is_frame = decoder_get_byte (decoder);
+        size_t size = decoder_get_unsigned (decoder);
+
+        if (size > (size_t)(decoder->end - decoder->at))
+          {
+            decoder->failed = true;
+            return;
+          }
+
+        Environment *environment = *object;
+        if (!fill)
+          {
+            environment = env_init_with_capacity (NULL, size);
+            environment->is_frame = is_frame;
+            *object = environment;
+          }
+        else
+          environment->parent = parent;
+
+        for (size_t slot = 0; slot < size; slot++)
+          {
+            Value *key = get_value (reader);
+            Value *bound = get_value (reader);
+            Meta meta = get_meta (reader);
+            bool redefinable = decoder_get_byte (decoder);
+
+            if (fill)
+              environment->bindings[slot]
+                  = (Binding){ .key = key,
+                               .value = bound,
+                               .meta = meta,
+                               .redefinable = redefinable };
+          }
+
+        if (fill)
+          {
+            environment->bindings_size = size;
+            env_reindex (environment);
+          }
+        return;
+      }
+
+    case OBJECT_CALL_SITE:
+      {
+        int hops = decoder_get_signed (decoder);
+
+        if (!fill)
+          {
+            CallSite *site = carve (reader, &reader->region,
+                                    &reader->region_left, sizeof (CallSite));
+            if (site)
+              site->hops = hops;
+            *object = site;
+          }
+        return;
+      }
+
+    default:
+      decoder->failed = true;
+      return;
+    }
+}
+
+static Value *
+read_image (ImageReader *reader, const char *filename,
+            Environment **environment)
+{
+  Decoder *decoder = &reader->decoder;
+
+  Header header;
+  const unsigned char *bytes = decoder_get (decoder, sizeof (Header));
+  if (bytes)
+    memcpy (&header, bytes, sizeof (Header));
+  if (!bytes || header.magic != IMAGE_MAGIC
+      || header.version != IMAGE_VERSION)
+    return val_error ("image: %s is not an image of this version", filename);
+
+  reader->size = decoder_get_unsigned (decoder);
+  reader->region_left = decoder_get_unsigned (decoder);
+  reader->strings_left = decoder_get_unsigned (decoder);
+  size_t modules = decoder_get_unsigned (decoder);
+  bool shadowed = decoder_get_byte (decoder);
+  reader->filenames_size = decoder_get_unsigned (decoder);
+
+  // every object and filename takes at least a byte
+  size_t left = decoder->end - decoder->at;
+  if (decoder->failed || reader->size == 0 || reader->size > left
+      || modules >= reader->size || reader->filenames_size > left
+      || reader->region_left > left * sizeof (Carved)
+      || reader->strings_left > left)
+    return val_error ("image: %s is corrupt", filename);
+
+  reader->filenames = GC_malloc (reader->filenames_size * sizeof (char *));
+  for (size_t i = 0; i < reader->filenames_size; i++)
+    reader->filenames[i] = decoder_get_string (decoder);
+
+  reader->objects = GC_malloc (reader->size * sizeof (void *));
+  reader->kinds = GC_malloc_atomic (reader->size);
+  reader->region = GC_malloc (reader->region_left);
+  reader->strings = GC_malloc_atomic (reader->strings_left);
+
+  const unsigned char *objects = decoder->at;
+  for (int pass = 0; pass < 2; pass++)
+    {
+      decoder->at = objects;
+      reader->fill = pass == 1;
+
+      for (size_t i = 0; i < reader->size; i++)
+        {
+          read_object (reader, i);
+          if (reader->error)
+            return reader->error;
+          if (decoder->failed)
+            return val_error ("image: %s is corrupt", filename);
+        }
+    }
+
+  // the roots: the global environment, then the modules (registered again
+  // when they were allocated)
+  if (reader->kinds[0] != OBJECT_ENVIRONMENT)
+    return val_error ("image: %s is corrupt", filename);
+  for (size_t i = 1; i <= modules; i++)
+    if (reader->kinds[i] != VALUE_MODULE)
+      return val_error ("image: %s is corrupt", filename);
+
+  macro_names_shadowed |= shadowed;
+  *environment = reader->objects[0];
+  return val_nil ();
+}
+
+Value *
+image_load_bytes (const void *bytes, size_t size, const char *name,
+                  Set_Builtins_Function set_builtins,
+                  Environment **environment)
+{
+  ImageReader reader = {
+    .decoder = { .at = bytes, .end = (const unsigned char *)bytes + size },
+    .builtins = env_init (NULL),
+  };
+  set_builtins (reader.builtins);
+
+  return read_image (&reader, name, environment);
+}
+
+Value *
+image_load (const char *filename, Set_Builtins_Function set_builtins,
+            Environment **environment)
+{
+  MappedFile file;
+  if (!mapped_file_open (filename, &file))
+    return val_error ("image: cannot read %s", filename);
+
+  Value *result = image_load_bytes (file.data, file.size, filename,
+                                    set_builtins, environment);
+
+  mapped_file_close (&file);
+  return result;
+}
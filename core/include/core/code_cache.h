@@ -0,0 +1,58 @@
+#ifndef CODE_CACHE_H_
+#define CODE_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/encoding.h"
+#include "core/mapped_file.h"
+#include "core/value.h"
+
+// Bump whenever the encoding, or what the reader makes of some source,
+// changes: caches written by other versions are then ignored.
+#define CODE_CACHE_VERSION 3
+
+// The data read from a source file, kept in a compact binary form next to
+// it (foo.ode -> foo.odec) so the next load can skip lexing and reading.
+// Symbols are stored once by name, in a table interned in one go on load;
+// the data refer to them by position. A cache is used while the source has
+// the size and modification time it was written for, or, when only the
+// time changed, the same content hash.
+typedef struct
+{
+  const char *filename; // of the source
+
+  Encoder data; // encoded so far
+
+  Value **symbols; // in the order the data first use them
+  size_t symbols_size;
+  size_t symbols_capacity;
+
+  size_t *index; // open-addressed symbol -> position + 1, 0 marks empty
+  size_t index_capacity;
+
+  bool failed; // a datum could not be encoded, nothing will be written
+} CodeCacheWriter;
+
+// Cleared to neither use nor write caches (odeus --no-code-cache)
+extern bool code_cache_enabled;
+
+void code_cache_writer_init (CodeCacheWriter *writer, const char *filename);
+
+// Encode datum, which must be as the reader returned it: evaluating a form
+// rewrites parts of it. hash is its source hash (see Reader.hash).
+void code_cache_writer_add (CodeCacheWriter *writer, Value *datum,
+                            uint64_t hash);
+
+// Write the data added so far as the cache of source. Failing to is not an
+// error, the next load just reads the source again.
+void code_cache_write (CodeCacheWriter *writer, const MappedFile *source);
+
+// The data of the source file filename (mapped as source), as a list, if it
+// has a cache that is still valid and intact, with *hashes set to their
+// source hashes. NULL otherwise.
+Value *code_cache_read (const char *filename, const MappedFile *source,
+                        uint64_t **hashes);
+
+#endif // CODE_CACHE_H_
@@ -0,0 +1,80 @@
+#ifndef COMPILER_H_
+#define COMPILER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/environment.h"
+#include "core/eval.h"
+#include "core/value.h"
+
+// Instructions of the bytecode VM (see vm.h). Every operand is an unsigned
+// 16 bit number stored right after the opcode, low byte first.
+typedef enum
+{
+  OP_CONSTANT, // k: push constants[k]
+  OP_NIL,      // push nil
+  OP_POP,      // drop the top of the stack
+
+  // Variable references. The symbol is constants[k].
+  OP_LOCAL,  // depth slot k: parameter at a fixed frame address
+  OP_NAME,   // k: name bound at run time, plain env_get
+  OP_GLOBAL, // k cache: free symbol, looked up through caches[cache]
+  OP_MODULE, // k: constants[k] is a module reference, module_reference_get
+
+  // Operator of a call form whose head is a free symbol. When it turns out
+  // to name a macro, constants[form] is handed to the tree-walking
+  // evaluator instead and execution resumes at skip, past the call.
+  OP_OPERATOR, // k cache form skip
+
+  OP_DEFINE, // k target: bind k to nil in this frame, or push an error and
+             // jump when k is already bound
+  OP_BIND,   // k: pop a value and bind k to it in this frame
+  OP_SET,    // k: pop a value, set! k to it, push k
+
+  // Error values abort the innermost special form or body they show up in,
+  // becoming its result, just like ERROR_OUT does in the builtins.
+  OP_CHECK, // target: jump when the top is an error value
+
+  OP_JUMP,        // target
+  OP_JUMP_IF_NIL, // target: pop, jump when nil
+  OP_AND,         // target: jump when the top is nil, pop it otherwise
+  OP_OR,          // target: jump when the top is not nil, pop it otherwise
+
+  OP_CLOSURE,   // k: close the lambda template constants[k] over this frame
+  OP_CALL,      // argc: call stack[-argc - 1] with the argc values above it
+  OP_TAIL_CALL, // argc: same, replacing the current call
+  OP_EVAL,      // k: evaluate form constants[k] with evaluate_expression
+  OP_RETURN,
+} OpCode;
+
+typedef struct Chunk
+{
+  uint8_t *code;
+  size_t code_size;
+  size_t code_capacity;
+
+  Value **constants;
+  size_t constants_size;
+  size_t constants_capacity;
+
+  // OP_GLOBAL and OP_OPERATOR lookup caches
+  CallSite *caches;
+  size_t caches_size;
+  size_t caches_capacity;
+
+  // parameter list of the lambda the chunk was compiled from, nil for
+  // top level code
+  Value *parameters;
+} Chunk;
+
+// Compile an expression to run in environment. Macros are expanded with
+// the definitions visible in environment at this point; NULL with *error
+// set when the expression cannot be compiled.
+Chunk *compile_expression (Environment *environment, Value *expression,
+                           Value **error);
+
+// Compile the body of a closure created by the tree-walking evaluator.
+Chunk *compile_closure (Value *closure, Value **error);
+
+#endif // COMPILER_H_
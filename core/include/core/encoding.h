@@ -0,0 +1,43 @@
+#ifndef ENCODING_H_
+#define ENCODING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte buffers for the binary files odeus writes (code caches, heap
+// images). Numbers are LEB128: seven bits per byte, the high bit set on all
+// but the last; signed ones are zigzag encoded first so small negative
+// numbers stay short. Everything else is stored as it is in memory, so
+// files are only read back on the kind of machine that wrote them.
+typedef struct
+{
+  unsigned char *bytes;
+  size_t size;
+  size_t capacity;
+} Encoder;
+
+void encoder_put (Encoder *encoder, const void *bytes, size_t size);
+void encoder_put_byte (Encoder *encoder, unsigned char byte);
+void encoder_put_unsigned (Encoder *encoder, uint64_t value);
+void encoder_put_signed (Encoder *encoder, int64_t value);
+void encoder_put_string (Encoder *encoder, const char *string);
+
+// Reading past the end, or a malformed number, sets failed and yields 0 or
+// NULL from then on, so callers can check once after a group of reads.
+typedef struct
+{
+  const unsigned char *at;
+  const unsigned char *end;
+  bool failed;
+} Decoder;
+
+const unsigned char *decoder_get (Decoder *decoder, size_t size);
+unsigned char decoder_get_byte (Decoder *decoder);
+uint64_t decoder_get_unsigned (Decoder *decoder);
+int64_t decoder_get_signed (Decoder *decoder);
+
+// A string put by encoder_put_string, as a NUL terminated copy
+char *decoder_get_string (Decoder *decoder);
+
+#endif // ENCODING_H_
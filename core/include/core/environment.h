@@ -1,6 +1,7 @@
 #ifndef ENVIRONMENT_H_
 #define ENVIRONMENT_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,7 +9,24 @@
 
 #include "core/meta.h"
 
-#define ENV_CAPACITY 4096
+// Frames start with room for this many bindings unless the caller knows
+// better (see env_init_with_capacity) and double whenever they fill up.
+#define ENV_INITIAL_CAPACITY 8
+
+// Environments holding more bindings than this (the global environment and
+// modules) get a hash index from symbol to slot, so lookups stop scanning.
+#define ENV_INDEX_THRESHOLD 16
+
+// Bumped whenever a binding is added to or removed from an environment
+// other than a call frame, which is what can invalidate a cached lookup.
+extern unsigned long env_version;
+
+// Bumped whenever a name that has been bound to a macro is bound again or
+// removed, which is what can make a macro expansion stale. Once such a name
+// is bound to something else, or in a call frame, the same macro name may
+// mean different things in different places and macro_names_shadowed is set.
+extern unsigned long macro_version;
+extern bool macro_names_shadowed;
 
 // forward declarations to resolve cycling includes
 typedef struct Value Value;
@@ -20,20 +38,63 @@ typedef struct
 
   Value *value;
   Meta meta;
+
+  // restored with the built-in prelude: define may bind the name again,
+  // which replaces it (see env_mark_redefinable)
+  bool redefinable;
 } Binding;
 
 typedef struct Env
 {
   struct Env *parent;
-  Binding bindings[ENV_CAPACITY];
+  Binding *bindings;
   size_t bindings_size;
+  size_t bindings_capacity;
+
+  // open-addressed symbol -> slot + 1 table (0 marks an empty entry),
+  // NULL while the environment is small enough to scan
+  size_t *index;
+  size_t index_capacity;
+
+  // call frames (lambda and macro applications) are never used as the
+  // starting point of a cached lookup, so binding in them does not bump
+  // env_version
+  bool is_frame;
+
+  // storage for the first bindings_capacity bindings, allocated together
+  // with the frame; bindings points here until the frame outgrows it
+  Binding inline_bindings[];
 } Environment;
 
+// The symbols bound in environment, not in its frames, while this is
+// env_binding_log: what each top-level form of a file defined, for
+// load-file. Bindings replaced by define count (see Binding.redefinable).
+typedef struct BindingLog
+{
+  Environment *environment;
+  Value **symbols;
+  size_t size;
+  size_t capacity;
+} BindingLog;
+
+extern BindingLog *env_binding_log;
+
 Environment *env_init (Environment *parent);
+Environment *env_init_with_capacity (Environment *parent, size_t capacity);
+Environment *env_init_frame (Environment *parent, size_t capacity);
 
 void env_set (Environment *env, Value *symbol, Value *value, Meta meta);
 Value *env_get (Environment *env, Value *symbol);
+Value *env_get_local (Environment *env, Value *local);
 Binding *env_get_binding (Environment *env, Value *symbol);
+Binding *env_get_own_binding (Environment *env, Value *symbol);
+Binding *env_get_cacheable_binding (Environment *env, Value *symbol);
 void env_update (Environment *env, Value *symbol, Value *value, Meta meta);
+bool env_is_defined (Environment *env, Value *symbol);
+void env_mark_redefinable (Environment *env, Environment *except);
+size_t env_remove_symbols (Environment *env, Value **symbols, size_t count);
+
+// Rebuild the hash index after bindings were filled in directly
+void env_reindex (Environment *env);
 
 #endif // ENVIRONMENT_H_
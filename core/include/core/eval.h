@@ -5,18 +5,90 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "core/ast.h"
 #include "core/value.h"
 #include "core/environment.h"
 
+// Two argument version of a numeric primitive for when both arguments are
+// integers. It must return what the primitive would for them.
+typedef Value *(*Integer_Operator) (long a, long b);
+
+void register_integer_operator (Primitive_Function primitive,
+                                Integer_Operator operator);
+
+// Inline cache for the operator of a call form whose head symbol is free in
+// every enclosing lambda (see resolve_lambda). The lookup starts `hops`
+// frames above the current one, which for all calls of the same closure is
+// the same environment, so the binding found there can be reused until
+// env_version changes. Other call forms get a site with hops 0 the first
+// time they are evaluated.
+struct CallSite
+{
+  int hops;
+
+  unsigned long version;
+  Environment *start;
+  Binding *binding;
+
+  // what evaluate_expression learned running the form: the primitive it
+  // calls, and that primitive's integer operator as long as it has only
+  // been given integers
+  Value *primitive;
+  Integer_Operator integer;
+  bool generic;
+
+  // once the form turned out to be a macro call: its expansion, as code
+  // the expander made, and the macro it came from. The form itself is left
+  // as it is, it may be data the program still holds (see eval).
+  Value *expansion;
+  Value *macro;
+  unsigned long expansion_version; // macro_version when last seen current
+};
+
+// What the alternative evaluators compiled a closure's body into. Closures
+// made from the same lambda form by them share one.
+struct Compiled
+{
+  size_t frame_size; // bindings a call frame needs for the parameters
+
+  struct Chunk *chunk; // vm.h
+  struct Node *node;   // node.h
+};
+
+Compiled *closure_compiled (Value *closure);
+
+CallSite *call_site_new (int hops);
+Value *call_site_lookup (CallSite *site, Environment *environment,
+                         Value *symbol);
+
+// The value of a VALUE_MODULE_REFERENCE. The exported binding is looked up
+// once and then used for as long as env_version says it can be, like a
+// call site's. A module that is not loaded yet is loaded by get-from-module.
+Value *module_reference_get (Environment *environment, Value *reference);
+
 Value *evaluate_expression (Environment *environment, Value *expression);
 Value *apply (Environment *environment, Value *function, Value *arguments);
+
+// For builtins: evaluate expression in environment as the result of the
+// current call, in tail position. The returned marker must be handed straight
+// back to the evaluator; C code calling such a builtin directly passes its
+// result through eval_trampoline first.
+Value *eval_tail_call (Environment *environment, Value *expression);
+Value *eval_trampoline (Value *result);
 Value *macro_expand_expression (Environment *environment, Value *expr);
 
+// For evaluators that evaluate arguments themselves: call a builtin or a
+// primitive on argument values (checking their number), and bind a lambda's parameters to them in frame (nil or
+// the error value the call evaluates to).
+Value *call_builtin (Environment *environment, Value *builtin,
+                     Value **arguments, size_t argc);
+Value *call_primitive (Value *primitive, Value **arguments, size_t argc);
+Value *bind_values (Environment *frame, Value *parameters, Value **arguments,
+                    size_t argc);
+
 #define ERROR_OUT(x)                                                          \
   do                                                                          \
     {                                                                         \
-      if ((x)->type == VALUE_ERROR)                                             \
+      if (TYPE (x) == VALUE_ERROR)                                            \
         return (x);                                                           \
     }                                                                         \
   while (0)
@@ -0,0 +1,34 @@
+#ifndef EXPAND_H_
+#define EXPAND_H_
+
+#include "core/environment.h"
+#include "core/reader.h"
+#include "core/value.h"
+
+// Expand every macro call in expression, including those nested inside
+// lambda bodies and argument lists, using the macros bound in environment
+// right now. Quasiquote templates are rewritten into the list building code
+// they stand for. The result is made of code conses (see val_code) that can
+// be rewritten as it runs: expression itself is never changed, and only
+// quoted data and code conses it already had are shared with it. Calls
+// whose expansion fails are kept as they are, for the evaluator to report
+// the error when it gets to them.
+Value *macro_expand_all (Environment *environment, Value *expression);
+
+// Same for the body of a lambda taking parameters.
+Value *macro_expand_body (Environment *environment, Value *parameters,
+                          Value *body);
+
+// Code the expander made turned back into plain data, as the reader would
+// have returned it (resolved references become their symbols again), for
+// handing it to Lisp code such as a macro.
+Value *code_to_data (Value *code);
+
+// Evaluate the forms reader yields with evaluate, reading each one only
+// after the one before it has run and macro expanding it fully first, so
+// macros defined by a form apply to the ones after it. Returns the value of
+// the last form, or the first error (reading or evaluating).
+Value *evaluate_expanded (Environment *environment, Reader *reader,
+                          Value *(*evaluate) (Environment *, Value *));
+
+#endif // EXPAND_H_
@@ -0,0 +1,37 @@
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include "core/environment.h"
+#include "core/value.h"
+
+// Bump whenever what an image holds, or how, changes: images written by
+// other versions are refused.
+#define IMAGE_VERSION 6
+
+// What fills a fresh environment with the builtins (set_builtins). Builtins
+// are saved by the name they are registered under and recreated by it.
+typedef void (*Set_Builtins_Function) (Environment *environment);
+
+// Save the global environment, everything reachable from it (closures and
+// their environments, macro expansions already done in their bodies, the
+// symbols used and their source locations) and the loaded modules to
+// filename, so a later process can start from where this one is instead of
+// loading the same code again. What the evaluators learn while running
+// (call site caches, compiled code) is left out and relearned. Returns nil,
+// or an error value if something reachable cannot be saved.
+Value *image_dump (Environment *environment, const char *filename,
+                   Set_Builtins_Function set_builtins);
+
+// Restore the image saved in filename, which must come from the same
+// version: its modules are registered again and *environment is set to its
+// global environment. Returns nil or an error value.
+Value *image_load (const char *filename, Set_Builtins_Function set_builtins,
+                   Environment **environment);
+
+// Same for an image already in memory (such as the prelude built into
+// odeus), called name in error messages. Nothing is kept pointing into it.
+Value *image_load_bytes (const void *bytes, size_t size, const char *name,
+                         Set_Builtins_Function set_builtins,
+                         Environment **environment);
+
+#endif // IMAGE_H_
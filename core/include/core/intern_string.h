@@ -1,8 +0,0 @@
-#ifndef INTERN_STRING_H_
-#define INTERN_STRING_H_
-
-#include <string.h>
-
-const char *intern_string (const char *s);
-
-#endif // INTERN_STRING_H_
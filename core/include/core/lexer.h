@@ -28,4 +28,8 @@ Lexer lexer_from_file (char *filename, char *source, size_t source_size);
 Lexer lexer_from_string (char *source, size_t source_size);
 Token lexer_next_token (Lexer *lexer);
 
+// Decode the escapes in the text of a string token into out, which needs
+// room for length bytes plus a NUL. Returns the decoded length.
+size_t lexer_unescape (const char *text, size_t length, char *out);
+
 #endif // LEXER_H_
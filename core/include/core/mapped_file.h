@@ -0,0 +1,26 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+// A file mapped read-only into memory instead of read into a copy. The
+// lexer works on it directly since it never reads past source_size.
+typedef struct
+{
+  char *data;
+  size_t size;
+
+  // data[size] can be read and is '\0': the mapping's last page is zero
+  // filled past the end of the file unless the file ends on a page boundary
+  bool terminated;
+
+  struct timespec mtime; // when the file was last modified
+} MappedFile;
+
+// false (with errno set) if the file cannot be opened or mapped
+bool mapped_file_open (const char *filename, MappedFile *file);
+void mapped_file_close (MappedFile *file);
+
+#endif // MAPPED_FILE_H_
@@ -0,0 +1,15 @@
+#ifndef META_MAP_H_
+#define META_MAP_H_
+
+#include "core/meta.h"
+
+typedef struct Value Value;
+
+// Side table from a value to where in the source it came from. Values do
+// not carry their Meta themselves; only symbols get an entry, when they
+// are first interned.
+void meta_map_init ();
+Meta *meta_map_get (Value *value);
+void meta_map_set (Value *value, Meta meta);
+
+#endif // META_MAP_H_
@@ -6,6 +6,9 @@
 void module_map_init ();
 Value *module_map_get (const char *name);
 void module_map_set (const char *name, Value *value);
+void module_map_for_each (void (*function) (const char *name, Value *module,
+                                            void *data),
+                          void *data);
 
 
 #endif // MODULE_MAP_H_
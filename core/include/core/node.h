@@ -0,0 +1,20 @@
+#ifndef NODE_H_
+#define NODE_H_
+
+#include "core/environment.h"
+#include "core/value.h"
+
+// Closure compilation: each form is macro-expanded and turned once into a
+// tree of nodes, each carrying a C handler specialised for the shape of the
+// form it came from (constant, parameter, global, if, call, ...). Running a
+// node is a call to its handler, which skips the type dispatch, macro check
+// and symbol lookup evaluate_expression repeats every time it sees a form.
+//
+// Like the VM (see vm.h) it keeps lambda parameters in environment frames,
+// calls builtins through their usual interface and evaluates a top level
+// begin one form at a time.
+typedef struct Node Node;
+
+Value *node_evaluate (Environment *environment, Value *expression);
+
+#endif // NODE_H_
@@ -0,0 +1,47 @@
+#ifndef READER_H_
+#define READER_H_
+
+#include "core/code_cache.h"
+#include "core/core_error.h"
+#include "core/lexer.h"
+#include "core/value.h"
+
+// Builds values straight from the lexer's tokens, one top-level datum at a
+// time. Open lists are kept on an explicit stack rather than the C stack,
+// so neither the length nor the nesting depth of data is limited.
+typedef struct
+{
+  Lexer *lexer;
+  Token token; // next token, not consumed yet
+  Error error; // set when reader_next returns an error
+
+  // source hash of the datum reader_next returned last: of the type and text
+  // of its tokens, so the same for the same datum wherever it is in a file
+  // and whatever whitespace and comments surround it
+  uint64_t hash;
+
+  Value *data;            // without a lexer: the data still to be yielded
+  const uint64_t *hashes; // and their source hashes, if known
+  CodeCacheWriter *cache; // when set, gets every datum read
+} Reader;
+
+Reader reader_init (Lexer *lexer);
+
+// A reader yielding the data of a list, as read from a code cache with
+// their source hashes (or NULL)
+Reader reader_from_data (Value *data, const uint64_t *hashes);
+
+// The next datum, NULL once the input is exhausted, or an error value
+Value *reader_next (Reader *reader);
+
+// Skip the next datum without building it: *hash is set to its source hash
+// and *next to the lexer as it is right after it, which reads the datum
+// that follows when the reader is initialised with it. false once the input
+// is exhausted, or on the syntax errors that can be told without reading
+// (reader->error is set then).
+bool reader_skip (Reader *reader, uint64_t *hash, Lexer *next);
+
+// All remaining data as one program, (begin datum ...)
+Value *reader_read_program (Reader *reader);
+
+#endif // READER_H_
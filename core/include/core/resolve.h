@@ -0,0 +1,44 @@
+#ifndef RESOLVE_H_
+#define RESOLVE_H_
+
+#include <stdbool.h>
+
+#include "core/environment.h"
+#include "core/value.h"
+
+// What is known at compile time about the names a lambda body can see.
+typedef struct Scope
+{
+  struct Scope *parent;
+  Value *parameters;
+  Value *dynamic; // symbols the body binds in its own frame at run time
+  bool open;      // body may bind names we cannot see (macros, eval, ...)
+} Scope;
+
+typedef enum
+{
+  REFERENCE_LOCAL,   // parameter of an enclosing lambda
+  REFERENCE_DYNAMIC, // may be bound at run time in one of the frames
+  REFERENCE_FREE,    // not bound by any enclosing lambda
+} ReferenceKind;
+
+// Scope of a lambda with the given parameters and body, nested in parent
+// (NULL for a lambda evaluated at top level).
+Scope scope_init (Scope *parent, Environment *environment, Value *parameters,
+                  Value *body);
+
+// Classify a reference to symbol. For REFERENCE_LOCAL depth and slot are its
+// address; for REFERENCE_FREE depth is the number of enclosing lambdas.
+ReferenceKind scope_lookup (Scope *scope, Value *symbol, int *depth,
+                            int *slot);
+
+// Rewrite references to lambda parameters inside body into VALUE_LOCAL
+// nodes holding a precomputed (depth, slot) address, and return the body to
+// use. That is body itself, rewritten in place, when it is code the
+// expander made, and an expanded copy of it otherwise. Symbols that may be
+// bound at run time by define/set!/let, by macro expansions or by eval are
+// left alone and keep the dynamic lookup.
+Value *resolve_lambda (Environment *environment, Value *parameters,
+                       Value *body);
+
+#endif // RESOLVE_H_
@@ -0,0 +1,30 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include <stddef.h>
+
+// What the lexer does with each byte, as bits of char_class
+enum
+{
+  CHAR_DELIMITER = 1 << 0,   // ends a symbol, every other byte is part of it
+  CHAR_SPACE = 1 << 1,       // whitespace between tokens
+  CHAR_NUMBER = 1 << 2,      // digits and '.', after a number's sign
+  CHAR_STRING_STOP = 1 << 3, // ends a run of plain string contents
+};
+
+extern const unsigned char char_class[256];
+
+#define CHAR_IS(ch, class) (char_class[(unsigned char)(ch)] & (class))
+#define IS_SYMBOL_CHAR(ch) (!CHAR_IS (ch, CHAR_DELIMITER))
+
+// Length of the run of bytes at the start of text (of the given length)
+// that are whitespace, symbol characters, number characters, or plain
+// string contents. They look at 32 or 16 bytes at a time with AVX2 or
+// SSE2 when the processor has them, one byte at a time through char_class
+// otherwise, and never read past length.
+size_t scan_whitespace (const char *text, size_t length);
+size_t scan_symbol (const char *text, size_t length);
+size_t scan_number (const char *text, size_t length);
+size_t scan_string (const char *text, size_t length);
+
+#endif // SCAN_H_
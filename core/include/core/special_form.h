@@ -0,0 +1,35 @@
+#ifndef SPECIAL_FORM_H_
+#define SPECIAL_FORM_H_
+
+#include "core/value.h"
+
+// Builtins that look at their arguments as code instead of just evaluating
+// them. Code analysis passes (resolve_lambda, the compiler) recognise them
+// by the name of the operator symbol.
+typedef enum
+{
+  SPECIAL_NONE = 0,
+
+  SPECIAL_QUOTE,
+  SPECIAL_QUASIQUOTE,
+  SPECIAL_IF,
+  SPECIAL_BEGIN,
+  SPECIAL_AND,
+  SPECIAL_OR,
+  SPECIAL_LAMBDA,
+  SPECIAL_MACRO,
+  SPECIAL_DEFINE,
+  SPECIAL_DEFMACRO,
+  SPECIAL_SET,
+  SPECIAL_LET,
+  SPECIAL_LET_STAR,
+
+  // evaluate code that is not visible in the form itself (eval, load-file)
+  SPECIAL_EVAL,
+  // take some arguments unevaluated (symbols naming modules, bindings, ...)
+  SPECIAL_RAW,
+} SpecialForm;
+
+SpecialForm special_form (Value *symbol);
+
+#endif // SPECIAL_FORM_H_
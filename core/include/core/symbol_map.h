@@ -1,10 +1,69 @@
 #ifndef SYMBOL_MAP_H_
 #define SYMBOL_MAP_H_
 
+#include <stdint.h>
+
 #include "core/value.h"
 
+// Symbols core/ and builtins/ refer to themselves. symbol_map_init interns
+// them up front so code can compare against CORE_SYMBOL (QUOTE) instead of
+// interning or strcmp-ing the name every time.
+#define CORE_SYMBOLS(X)                                                       \
+  X (T, "t")                                                                  \
+  X (NIL, "nil")                                                              \
+  X (QUOTE, "quote")                                                          \
+  X (QUASIQUOTE, "quasiquote")                                                \
+  X (UNQUOTE, "unquote")                                                      \
+  X (UNQUOTE_SPLICING, "unquote-splicing")                                    \
+  X (LIST, "list")                                                            \
+  X (CONS, "cons")                                                            \
+  X (APPEND, "append")                                                        \
+  X (IF, "if")                                                                \
+  X (BEGIN, "begin")                                                          \
+  X (AND, "and")                                                              \
+  X (OR, "or")                                                                \
+  X (LAMBDA, "lambda")                                                        \
+  X (MACRO, "macro")                                                          \
+  X (DEFINE, "define")                                                        \
+  X (DEFMACRO, "defmacro")                                                    \
+  X (SET, "set!")                                                             \
+  X (LET, "let")                                                              \
+  X (LET_STAR, "let*")                                                        \
+  X (EVAL, "eval")                                                            \
+  X (LOAD_FILE, "load-file")                                                  \
+  X (RELOAD_FILE, "reload-file")                                              \
+  X (MACROEXPAND, "macroexpand")                                              \
+  X (SHOW_META, "show-meta")                                                  \
+  X (GET_FROM_MODULE, "get-from-module")                                      \
+  X (LOAD_MODULE, "load-module")                                              \
+  X (RELOAD_MODULE, "reload-module")                                          \
+  X (APPLY, "apply")                                                          \
+  X (SYMBOL, "symbol")                                                        \
+  X (INTEGER, "integer")                                                      \
+  X (FLOAT, "float")                                                          \
+  X (STRING, "string")                                                        \
+  X (FUNCTION, "function")
+
+typedef enum
+{
+#define X(id, name) CORE_SYMBOL_##id,
+  CORE_SYMBOLS (X)
+#undef X
+  CORE_SYMBOL_COUNT
+} CoreSymbol;
+
+extern Value *core_symbols[CORE_SYMBOL_COUNT];
+
+#define CORE_SYMBOL(id) (core_symbols[CORE_SYMBOL_##id])
+
 void symbol_map_init ();
-Value *symbol_map_get (const char *name);
-void symbol_map_set (const char *name, Value* value);
+
+// Lookups take the name's hash so val_symbol computes it only once, and
+// only allocates a copy of the name for a symbol that is not there yet.
+// Names are given with their length, so they can be slices of a larger
+// string (see val_symbol_slice).
+uint32_t symbol_map_hash (const char *name, size_t length);
+Value *symbol_map_get (const char *name, size_t length, uint32_t hash);
+void symbol_map_add (Value *symbol);
 
 #endif // SYMBOL_MAP_H_
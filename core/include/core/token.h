@@ -21,10 +21,13 @@ typedef enum
   TOKEN_END_OF_FILE
 } Token_Type;
 
+// The text of a token is a slice of the lexer's source, not a copy. For
+// strings it is what is between the quotes, escapes still in it.
 typedef struct
 {
   Token_Type type;
-  char *value;
+  const char *text;
+  size_t length;
   size_t line;
   size_t column;
   size_t position;
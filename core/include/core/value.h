@@ -2,12 +2,14 @@
 #define VALUE_H_
 
 #include <assert.h>
+#include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-#include "core/ast.h"
 #include "core/environment.h"
 #include "core/meta.h"
 
@@ -20,79 +22,209 @@ typedef enum
   VALUE_STRING,
   VALUE_CONS,
 
-  VALUE_BUILTIN,
+  VALUE_BUILTIN,   // special form, gets its arguments unevaluated
+  VALUE_PRIMITIVE, // builtin function, gets its arguments' values
   VALUE_LAMBDA,
   VALUE_MACRO,
   VALUE_MODULE,
 
+  // lexically addressed variable reference, produced by resolve_lambda
+  VALUE_LOCAL,
+
+  // module/symbol reference, produced by macro_expand_all
+  VALUE_MODULE_REFERENCE,
+
   VALUE_ERROR,
   VALUE_END_OF_FILE,
+
+  // internal marker returned by eval_tail_call, never seen by Lisp code
+  VALUE_TAIL_CALL,
 } ValueType;
 
 typedef struct Value Value;
+typedef struct CallSite CallSite;
+typedef struct Compiled Compiled;
 typedef Value *(*Builtin_Function) (Environment *environment,
                                     Value *arguments);
+typedef Value *(*Primitive_Function) (size_t argc, Value **argv);
+
+// max_arguments of a primitive taking any number of arguments
+#define PRIMITIVE_VARIADIC -1
 
+// Value.flags
+#define VALUE_FLAG_RESOLVED (1u << 0) // lambda body already went through resolve_lambda
+#define VALUE_FLAG_MACRO_NAME (1u << 1) // symbol has been bound to a macro
+#define VALUE_FLAG_UNLOCATED (1u << 2) // core symbol not read from source yet
+#define VALUE_FLAG_CODE (1u << 3) // cons made by the expander, see val_code
+
+// The header every value starts with. Each type has a struct of its own,
+// the header followed by what that type holds, and values are allocated
+// with just that much (see value.c); the AS_* macros below get at it. Source
+// locations are kept in a side table (see value_meta).
 struct Value
 {
   ValueType type;
-  union
-  {
-    long INTEGER;
-    double FLOAT;
-    char *STRING;
-    char *SYMBOL;
-
-    struct
-    {
-      Value *CAR;
-      Value *CDR;
-    } CONS;
-
-    struct
-    {
-      char *MESSAGE;
-    } ERROR;
-
-    // used in eval step
-    Builtin_Function BUILTIN;
-    struct
-    {
-      Environment *environment;
-      Value *parameters;
-      Value *body;
-    } CLOSURE;
-
-    struct
-    {
-      char *name;
-      Environment *environment;
-    } MODULE;
-
-  } as;
-
-  Meta meta;
+  unsigned int flags;
 };
 
-#define CAR(cons) ((cons)->as.CONS.CAR)
-#define CDR(cons) ((cons)->as.CONS.CDR)
+typedef struct
+{
+  Value header;
+  long value;
+} IntegerValue;
+
+typedef struct
+{
+  Value header;
+  double value;
+} FloatValue;
+
+typedef struct
+{
+  Value header;
+  char *value;
+} StringValue;
+
+typedef struct
+{
+  Value header;
+  char *name;
+  uint32_t hash; // see symbol_map.h
+} SymbolValue;
+
+typedef struct
+{
+  Value header;
+  Value *CAR;
+  Value *CDR;
+} ConsValue;
+
+// a cons flagged VALUE_FLAG_CODE (see val_code) is allocated with room for
+// the evaluators' cache of the form, list data is not
+typedef struct
+{
+  ConsValue cons;
+  CallSite *SITE; // operator lookup cache, see eval.h
+} CodeValue;
+
+typedef struct
+{
+  Value header;
+  char *MESSAGE;
+} ErrorValue;
+
+// used in eval step
+typedef struct
+{
+  Value header;
+  Builtin_Function function;
+} BuiltinValue;
+
+typedef struct
+{
+  Value header;
+  Primitive_Function function;
+  const char *name;
+  int min_arguments;
+  int max_arguments;
+} PrimitiveValue;
+
+// lambdas and macros
+typedef struct
+{
+  Value header;
+  Environment *environment;
+  Value *parameters;
+  Value *body;
+  Compiled *compiled; // see eval.h, filled in on first use
+} ClosureValue;
+
+// the top-level bindings of environment (not those of its parents) are what
+// the module exports
+typedef struct
+{
+  Value header;
+  char *name;
+  Environment *environment;
+
+  // of the file when it was loaded, to tell when it has to be again
+  struct timespec mtime;
+  size_t size;
+} ModuleValue;
+
+typedef struct
+{
+  Value header;
+  Value *symbol;
+  int depth; // frames to walk up from the current one
+  int slot;  // index into that frame's bindings
+} LocalValue;
+
+typedef struct
+{
+  Value header;
+  Value *module; // name of the module, as a symbol
+  Value *symbol;
+
+  // the exported binding, valid while env_version is still version
+  unsigned long version;
+  Binding *binding;
+} ModuleReferenceValue;
+
+#define AS_INTEGER(v) ((IntegerValue *)(v))
+#define AS_FLOAT(v) ((FloatValue *)(v))
+#define AS_STRING(v) ((StringValue *)(v))
+#define AS_SYMBOL(v) ((SymbolValue *)(v))
+#define AS_CONS(v) ((ConsValue *)(v))
+#define AS_CODE(v) ((CodeValue *)(v))
+#define AS_ERROR(v) ((ErrorValue *)(v))
+#define AS_BUILTIN(v) ((BuiltinValue *)(v))
+#define AS_PRIMITIVE(v) ((PrimitiveValue *)(v))
+#define AS_CLOSURE(v) ((ClosureValue *)(v))
+#define AS_MODULE(v) ((ModuleValue *)(v))
+#define AS_LOCAL(v) ((LocalValue *)(v))
+#define AS_MODULE_REFERENCE(v) ((ModuleReferenceValue *)(v))
+
+#define CAR(cons) (AS_CONS (cons)->CAR)
+#define CDR(cons) (AS_CONS (cons)->CDR)
 
 #define CAAR(cons) (CAR (CAR ((cons))))
 #define CADR(cons) (CAR (CDR ((cons))))
 #define CDAR(cons) (CDR (CAR ((cons))))
 #define CDDR(cons) (CDR (CDR ((cons))))
 
-#define IS_NULL(a) ((a) == NULL || (a)->type == VALUE_NIL)
+// Integers that fit in all but one bit of a word are not allocated: the
+// Value pointer itself holds (n << 1) | 1, which no Value in the heap can
+// have. Anything that may be handed a number reads its type and integer
+// through these instead of the fields; larger integers stay boxed.
+#define IS_FIXNUM(v) (((uintptr_t)(v)) & 1)
+#define FIXNUM_MIN (LONG_MIN >> 1)
+#define FIXNUM_MAX (LONG_MAX >> 1)
+
+#define TYPE(v) (IS_FIXNUM (v) ? VALUE_INTEGER : (v)->type)
+#define INTEGER_VALUE(v)                                                      \
+  (IS_FIXNUM (v) ? (long)((intptr_t)(v) >> 1) : AS_INTEGER (v)->value)
 
-Value *val_from_ast (AST *node);
+#define IS_NULL(a) ((a) == NULL || TYPE (a) == VALUE_NIL)
 
 Value *val_integer (long value);
 Value *val_float (double value);
 Value *val_string (const char *string);
+// string is not copied, and must live as long as the value (GC allocated)
+Value *val_string_take (char *string);
 Value *val_symbol (const char *symbol, Meta meta);
+Value *val_symbol_slice (const char *name, size_t length, Meta meta);
 Value *val_cons (Value *car, Value *cdr);
+// A cons of code owned by the evaluators: the expander copies the forms it
+// is given into these, and only these are ever rewritten as they run, so
+// data the program can still reach (a list handed to eval) never is
+Value *val_code (Value *car, Value *cdr);
 Value *val_builtin (Builtin_Function builtin_function);
+Value *val_primitive (const char *name, Primitive_Function function,
+                      int min_arguments, int max_arguments);
 Value* val_module(const char* module_name, Environment* environment);
+Value *val_local (Value *symbol, int depth, int slot);
+Value *val_module_reference (Value *module, Value *symbol);
 
 // special VALUE node builder, only for error messages
 Value *val_error (const char *message, ...);
@@ -100,6 +232,9 @@ Value *val_error (const char *message, ...);
 Value *val_nil (void);
 Value *val_t (void);
 
+// Where value was read from, or an empty Meta if that is not known
+Meta value_meta (Value *value);
+
 char *value_to_string (Value *node);
 void value_print (Value *node);
 
@@ -0,0 +1,17 @@
+#ifndef VM_H_
+#define VM_H_
+
+#include "core/environment.h"
+#include "core/value.h"
+
+// Evaluate expression with the bytecode VM instead of evaluate_expression.
+// The expression is macro-expanded and compiled first (see compiler.h); a
+// top level begin is compiled and run one form at a time, so macros defined
+// by a form apply to the ones after it.
+//
+// Lambdas keep their parameters in ordinary environment frames, so closures
+// move freely between the two evaluators, and builtins are called through
+// their usual Builtin_Function interface.
+Value *vm_evaluate (Environment *environment, Value *expression);
+
+#endif // VM_H_
@@ -1,20 +1,24 @@
 #include "core/lexer.h"
+#include "core/scan.h"
 #include "core/token.h"
 
 static char peek (Lexer *lexer);
 static char peek_next (Lexer *lexer, int n);
 static void advance (Lexer *lexer);
+static void advance_by (Lexer *lexer, size_t count);
+static size_t remaining (Lexer *lexer);
+static void skip_whitespace (Lexer *lexer);
+static void skip_comment (Lexer *lexer);
 static void panic (Lexer *lexer, const char *message);
-static bool is_allowed_for_symbol (char ch);
-static char *copy_substring (const char *src, size_t start, size_t end);
+static char escaped_character (char ch);
 
 static Token string_token (Lexer *lexer);
 static Token number_token (Lexer *lexer);
 static Token symbol_token (Lexer *lexer);
 
 static Token create_token (Lexer *lexer, Token_Type type);
-static Token create_token_with_value (Lexer *lexer, Token_Type type,
-                                      char *value);
+static Token create_token_with_text (Lexer *lexer, Token_Type type,
+                                     size_t start, size_t end);
 
 Lexer
 lexer_from_file (char *filename, char *source, size_t source_size)
@@ -60,13 +64,8 @@ lexer_next_token (Lexer *lexer)
         case ' ':
         case '\t':
         case '\r':
-          advance (lexer);
-          break;
-
         case '\n':
-          lexer->line++;
-          lexer->column = 0;
-          advance (lexer);
+          skip_whitespace (lexer);
           break;
 
         // Single-character tokens
@@ -93,15 +92,14 @@ lexer_next_token (Lexer *lexer)
           return create_token (lexer, TOKEN_QUOTE);
 
         case '.':
-          if (is_allowed_for_symbol (peek_next (lexer, 1)))
+          if (IS_SYMBOL_CHAR (peek_next (lexer, 1)))
             return symbol_token (lexer);
           advance (lexer);
           return create_token (lexer, TOKEN_PERIOD);
 
         // Comments
         case ';':
-          while (peek (lexer) != '\n')
-            advance (lexer);
+          skip_comment (lexer);
           continue;
 
         // Strings
@@ -118,7 +116,7 @@ lexer_next_token (Lexer *lexer)
           if (isdigit (peek (lexer))
               || (peek (lexer) == '-' && isdigit (peek_next (lexer, 1))))
             return number_token (lexer);
-          else if (is_allowed_for_symbol (peek (lexer)))
+          else if (IS_SYMBOL_CHAR (peek (lexer)))
             return symbol_token (lexer);
           else
             {
@@ -155,6 +153,55 @@ advance (Lexer *lexer)
   lexer->column++;
 }
 
+static void
+advance_by (Lexer *lexer, size_t count)
+{
+  lexer->position += count;
+  lexer->column += count;
+}
+
+// bytes of source from the current position on
+static size_t
+remaining (Lexer *lexer)
+{
+  if (lexer->position >= lexer->source_size)
+    return 0;
+  return lexer->source_size - lexer->position;
+}
+
+static void
+skip_whitespace (Lexer *lexer)
+{
+  const char *start = lexer->source + lexer->position;
+  size_t length = scan_whitespace (start, remaining (lexer));
+  const char *end = start + length;
+
+  // the column restarts after every newline
+  const char *line_start = start;
+  const char *newline;
+  while ((newline = memchr (line_start, '\n', end - line_start)))
+    {
+      lexer->line++;
+      line_start = newline + 1;
+    }
+
+  lexer->position += length;
+  if (line_start == start)
+    lexer->column += length;
+  else
+    lexer->column = end - line_start + 1;
+}
+
+// up to the newline ending the comment, or the end of the source
+static void
+skip_comment (Lexer *lexer)
+{
+  const char *start = lexer->source + lexer->position;
+  const char *newline = memchr (start, '\n', remaining (lexer));
+
+  advance_by (lexer, newline ? (size_t)(newline - start) : remaining (lexer));
+}
+
 static void
 panic (Lexer *lexer, const char *message)
 {
@@ -165,33 +212,22 @@ panic (Lexer *lexer, const char *message)
   lexer->error.column = lexer->column;
 }
 
-static char *
-copy_substring (const char *src, size_t start, size_t end)
-{
-  size_t length = end - start;
-  char *s = malloc (length + 1);
-  if (!s)
-    {
-      fprintf (stderr, "Out of memory\n");
-      exit (EXIT_FAILURE);
-    }
-  memcpy (s, src + start, length);
-  s[length] = '\0';
-  return s;
-}
-
 static Token
 create_token (Lexer *lexer, Token_Type type)
 {
-  return create_token_with_value (lexer, type, NULL);
+  return create_token_with_text (lexer, type, lexer->position,
+                                 lexer->position);
 }
 
 static Token
-create_token_with_value (Lexer *lexer, Token_Type type, char *value)
+create_token_with_text (Lexer *lexer, Token_Type type, size_t start,
+                        size_t end)
 {
   Token token = { 0 };
   token.type = type;
-  token.value = value;
+  token.text = lexer->source + start;
+  token.length = end - start;
+  token.position = start;
   token.line = lexer->line;
 
   token.column = lexer->token_start_column;
@@ -203,121 +239,116 @@ static Token
 string_token (Lexer *lexer)
 {
   advance (lexer); // skip opening quote
+  size_t string_start = lexer->position;
 
-  size_t capacity = 64;
-  size_t length = 0;
-  char *buffer = malloc (capacity);
-  if (!buffer)
-    panic (lexer, "out of memory");
-
-  while (peek (lexer) != '"' && peek (lexer) != '\0')
+  while (true)
     {
-      if (peek (lexer) == '\n')
-        panic (lexer, "incomplete string");
+      advance_by (lexer, scan_string (lexer->source + lexer->position,
+                                      remaining (lexer)));
 
-      char c = ' ';
+      char c = peek (lexer);
+      if (c == '"' || c == '\0')
+        break;
 
-      if (peek (lexer) == '\\')
-        {
-          advance (lexer);
-          switch (peek (lexer))
-            {
-            case 'n':
-              c = '\n';
-              break;
-            case 't':
-              c = '\t';
-              break;
-            case 'r':
-              c = '\r';
-              break;
-            case '"':
-              c = '"';
-              break;
-            case '\'':
-              c = '\'';
-              break;
-            case '\\':
-              c = '\\';
-              break;
-            default:
-              panic (lexer, "illegal character to escape");
-            }
-        }
+      if (c == '\n')
+        panic (lexer, "incomplete string");
       else
-        c = peek (lexer);
-
-      if (length + 1 >= capacity)
         {
-          capacity *= 2;
-          char *newbuf = realloc (buffer, capacity);
-          if (!newbuf)
-            {
-              free (buffer);
-              panic (lexer, "out of memory while parsing string");
-            }
-          buffer = newbuf;
+          advance (lexer); // the backslash
+          if (!escaped_character (peek (lexer)))
+            panic (lexer, "illegal character to escape");
         }
 
-      buffer[length++] = c;
       advance (lexer);
     }
 
+  size_t string_end = lexer->position;
+
   if (peek (lexer) != '"')
     panic (lexer, "unterminated string literal");
 
-  buffer[length] = '\0';
   advance (lexer); // skip closing quote
 
-  return create_token_with_value (lexer, TOKEN_STRING, buffer);
+  return create_token_with_text (lexer, TOKEN_STRING, string_start,
+                                 string_end);
 }
 
-static Token
-number_token (Lexer *lexer)
+// What \ch stands for in a string, or 0 if it is not a valid escape
+static char
+escaped_character (char ch)
 {
-  size_t number_start = lexer->position;
-  bool is_float = false;
+  switch (ch)
+    {
+    case 'n':
+      return '\n';
+    case 't':
+      return '\t';
+    case 'r':
+      return '\r';
+    case '"':
+      return '"';
+    case '\'':
+      return '\'';
+    case '\\':
+      return '\\';
+    default:
+      return 0;
+    }
+}
 
-  if (peek (lexer) == '-')
-    advance (lexer);
+size_t
+lexer_unescape (const char *text, size_t length, char *out)
+{
+  size_t out_length = 0;
 
-  while (isdigit (peek (lexer)) || peek (lexer) == '.')
+  for (size_t i = 0; i < length; i++)
     {
-      if (peek (lexer) == '.')
+      char c = text[i];
+      if (c == '\\' && i + 1 < length)
         {
-          if (is_float)
-            panic (lexer, "multiple '.' in number");
-          is_float = true;
+          // invalid escapes were reported by the lexer and read as a space
+          c = escaped_character (text[++i]);
+          if (!c)
+            c = ' ';
         }
-      advance (lexer);
+      out[out_length++] = c;
     }
 
-  size_t number_end = lexer->position;
-  char *number = copy_substring (lexer->source, number_start, number_end);
-
-  Token_Type type = is_float ? TOKEN_FLOAT : TOKEN_INTEGER;
-  return create_token_with_value (lexer, type, number);
+  out[out_length] = '\0';
+  return out_length;
 }
 
 static Token
-symbol_token (Lexer *lexer)
+number_token (Lexer *lexer)
 {
-  size_t symbol_start = lexer->position;
+  size_t number_start = lexer->position;
 
-  while (is_allowed_for_symbol (peek (lexer)))
+  if (peek (lexer) == '-')
     advance (lexer);
 
-  size_t symbol_end = lexer->position;
-  char *symbol = copy_substring (lexer->source, symbol_start, symbol_end);
+  const char *digits = lexer->source + lexer->position;
+  size_t length = scan_number (digits, remaining (lexer));
 
-  return create_token_with_value (lexer, TOKEN_SYMBOL, symbol);
+  const char *dot = memchr (digits, '.', length);
+  bool is_float = dot != NULL;
+  if (dot && memchr (dot + 1, '.', digits + length - dot - 1))
+    panic (lexer, "multiple '.' in number");
+
+  advance_by (lexer, length);
+
+  Token_Type type = is_float ? TOKEN_FLOAT : TOKEN_INTEGER;
+  return create_token_with_text (lexer, type, number_start,
+                                 lexer->position);
 }
 
-static bool
-is_allowed_for_symbol (char ch)
+static Token
+symbol_token (Lexer *lexer)
 {
-  if (ch == '\0')
-    return false;
-  const char *not_allowed = " \t\n\r()[]\";,\'`|\\@";
-  return strchr (not_allowed, ch) == NULL;
+  size_t symbol_start = lexer->position;
+
+  advance_by (lexer, scan_symbol (lexer->source + lexer->position,
+                                  remaining (lexer)));
+
+  return create_token_with_text (lexer, TOKEN_SYMBOL, symbol_start,
+                                 lexer->position);
 }
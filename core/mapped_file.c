@@ -0,0 +1,52 @@
+#include "core/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool
+mapped_file_open (const char *filename, MappedFile *file)
+{
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat status;
+  if (fstat (fd, &status) < 0)
+    {
+      close (fd);
+      return false;
+    }
+
+  file->size = status.st_size;
+  file->mtime = status.st_mtim;
+
+  // mmap refuses empty mappings
+  if (file->size == 0)
+    {
+      close (fd);
+      file->data = "";
+      file->terminated = true;
+      return true;
+    }
+
+  void *data = mmap (NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  file->data = data;
+  file->terminated = file->size % sysconf (_SC_PAGESIZE) != 0;
+  return true;
+}
+
+void
+mapped_file_close (MappedFile *file)
+{
+  if (file->size > 0)
+    munmap (file->data, file->size);
+
+  file->data = NULL;
+  file->size = 0;
+}
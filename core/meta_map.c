@@ -0,0 +1,100 @@
+#include "core/meta_map.h"
+
+#include <gc/gc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 2048
+#define LOAD_FACTOR 0.8
+
+typedef struct
+{
+  Value *key;
+  Meta meta;
+} Entry;
+
+static Entry *table = NULL;
+static size_t capacity = 0;
+static size_t size = 0;
+
+static size_t
+hash (Value *value)
+{
+  uintptr_t h = (uintptr_t)value >> 4;
+  h ^= h >> 16;
+  h *= 0x45d9f3bu;
+  return h ^ (h >> 16);
+}
+
+static void
+resize (size_t new_capacity)
+{
+  Entry *old = table;
+  size_t old_capacity = capacity;
+
+  table = GC_malloc (new_capacity * sizeof (Entry));
+  memset (table, 0, new_capacity * sizeof (Entry));
+  capacity = new_capacity;
+  size = 0;
+
+  if (!old)
+    return;
+
+  for (size_t i = 0; i < old_capacity; i++)
+    if (old[i].key)
+      meta_map_set (old[i].key, old[i].meta);
+}
+
+void
+meta_map_init ()
+{
+  resize (INITIAL_CAPACITY);
+}
+
+Meta *
+meta_map_get (Value *value)
+{
+  if (size == 0)
+    return NULL;
+
+  size_t i = hash (value) % capacity;
+
+  while (true)
+    {
+      if (!table[i].key)
+        return NULL;
+      if (table[i].key == value)
+        return &table[i].meta;
+
+      i = (i + 1) % capacity;
+    }
+}
+
+void
+meta_map_set (Value *value, Meta meta)
+{
+  if ((double)(size + 1) / capacity > LOAD_FACTOR)
+    resize (capacity * 2);
+
+  size_t i = hash (value) % capacity;
+
+  while (true)
+    {
+      if (!table[i].key)
+        {
+          table[i].key = value;
+          table[i].meta = meta;
+          size++;
+          return;
+        }
+
+      if (table[i].key == value)
+        {
+          table[i].meta = meta;
+          return;
+        }
+
+      i = (i + 1) % capacity;
+    }
+}
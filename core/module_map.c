@@ -103,3 +103,13 @@ module_map_set (const char *name, Value *value)
       i = (i + 1) % capacity;
     }
 }
+
+void
+module_map_for_each (void (*function) (const char *name, Value *module,
+                                       void *data),
+                     void *data)
+{
+  for (size_t i = 0; table && i < capacity; i++)
+    if (table[i].key)
+      function (table[i].key, table[i].value, data);
+}
@@ -0,0 +1,690 @@
+#include "core/node.h"
+#include "core/eval.h"
+#include "core/expand.h"
+#include "core/resolve.h"
+#include "core/special_form.h"
+
+#include <gc/gc.h>
+#include <stdbool.h>
+
+typedef Value *(*NodeHandler) (Node *node, Environment *environment);
+
+struct Node
+{
+  NodeHandler run;
+
+  union
+  {
+    Value *constant;
+    Value *form; // handed to evaluate_expression as is
+    Value *lambda; // closure template, everything but the environment
+    Value *reference; // VALUE_MODULE_REFERENCE
+
+    struct
+    {
+      Value *symbol;
+      int depth;
+      int slot;
+    } local;
+
+    struct
+    {
+      Value *symbol;
+      CallSite *site;
+    } global;
+
+    struct
+    {
+      Node *condition;
+      Node *then;
+      Node *otherwise;
+    } branch;
+
+    // begin, and, or and lambda bodies
+    struct
+    {
+      Node **nodes;
+      size_t count;
+    } sequence;
+
+    // define and set!
+    struct
+    {
+      Value *symbol;
+      Node *value;
+    } definition;
+
+    struct
+    {
+      Value **symbols;
+      Node **values;
+      size_t count;
+      Node *body;
+    } let;
+
+    struct
+    {
+      Node *function;
+      Node **arguments;
+      size_t argc;
+      // the whole form, when function is a global that may turn out to
+      // be a macro defined after the form was compiled
+      Value *form;
+    } call;
+  } as;
+};
+
+typedef struct
+{
+  Scope *scope;
+  Environment *environment;
+} Context;
+
+// A call in tail position returns this after setting up the frame, and the
+// run_body loop of the closest call outside of it runs the callee's body.
+static Value TAIL_CALL = { .type = VALUE_TAIL_CALL };
+static Node *pending_body = NULL;
+static Environment *pending_frame = NULL;
+
+static Node *compile (Context *context, Value *expression, bool tail);
+static Node *compile_function (Scope *parent, Environment *environment,
+                               Value *parameters, Value *body);
+
+static Value *
+run_body (Node *body, Environment *frame)
+{
+  Value *result = body->run (body, frame);
+
+  while (result == &TAIL_CALL)
+    {
+      body = pending_body;
+      frame = pending_frame;
+      result = body->run (body, frame);
+    }
+
+  return result;
+}
+
+static Value *
+run_constant (Node *node, Environment *environment)
+{
+  (void)environment;
+  return node->as.constant;
+}
+
+static Value *
+run_eval (Node *node, Environment *environment)
+{
+  return evaluate_expression (environment, node->as.form);
+}
+
+static Value *
+run_local (Node *node, Environment *environment)
+{
+  Environment *frame = environment;
+  for (int depth = node->as.local.depth; depth > 0 && frame; depth--)
+    frame = frame->parent;
+
+  size_t slot = node->as.local.slot;
+  if (frame && slot < frame->bindings_size
+      && frame->bindings[slot].key == node->as.local.symbol)
+    return frame->bindings[slot].value;
+
+  return env_get (environment, node->as.local.symbol);
+}
+
+static Value *
+run_name (Node *node, Environment *environment)
+{
+  return env_get (environment, node->as.global.symbol);
+}
+
+static Value *
+run_global (Node *node, Environment *environment)
+{
+  return call_site_lookup (node->as.global.site, environment,
+                           node->as.global.symbol);
+}
+
+static Value *
+run_module_reference (Node *node, Environment *environment)
+{
+  return module_reference_get (environment, node->as.reference);
+}
+
+static Value *
+run_if (Node *node, Environment *environment)
+{
+  Node *condition = node->as.branch.condition;
+  Value *value = condition->run (condition, environment);
+  ERROR_OUT (value);
+
+  Node *branch
+      = IS_NULL (value) ? node->as.branch.otherwise : node->as.branch.then;
+  return branch->run (branch, environment);
+}
+
+static Value *
+run_sequence (Node *node, Environment *environment)
+{
+  Node **nodes = node->as.sequence.nodes;
+  size_t last = node->as.sequence.count - 1;
+
+  for (size_t i = 0; i < last; i++)
+    {
+      Value *value = nodes[i]->run (nodes[i], environment);
+      ERROR_OUT (value);
+    }
+
+  return nodes[last]->run (nodes[last], environment);
+}
+
+static Value *
+run_and (Node *node, Environment *environment)
+{
+  Node **nodes = node->as.sequence.nodes;
+  size_t last = node->as.sequence.count - 1;
+
+  for (size_t i = 0; i < last; i++)
+    {
+      Value *value = nodes[i]->run (nodes[i], environment);
+      ERROR_OUT (value);
+
+      if (IS_NULL (value))
+        return val_nil ();
+    }
+
+  return nodes[last]->run (nodes[last], environment);
+}
+
+static Value *
+run_or (Node *node, Environment *environment)
+{
+  Node **nodes = node->as.sequence.nodes;
+  size_t last = node->as.sequence.count - 1;
+
+  for (size_t i = 0; i < last; i++)
+    {
+      Value *value = nodes[i]->run (nodes[i], environment);
+      ERROR_OUT (value);
+
+      if (!IS_NULL (value))
+        return value;
+    }
+
+  return nodes[last]->run (nodes[last], environment);
+}
+
+static Value *
+run_define (Node *node, Environment *environment)
+{
+  Value *symbol = node->as.definition.symbol;
+  if (env_is_defined (environment, symbol))
+    return val_error ("define: symbol already defined: %s",
+                      AS_SYMBOL (symbol)->name);
+
+  env_set (environment, symbol, val_nil (), value_meta (symbol));
+
+  Node *definition = node->as.definition.value;
+  Value *value = definition->run (definition, environment);
+  ERROR_OUT (value);
+
+  env_update (environment, symbol, value, value_meta (symbol));
+  return symbol;
+}
+
+static Value *
+run_set (Node *node, Environment *environment)
+{
+  Value *symbol = node->as.definition.symbol;
+  if (!env_get_binding (environment, symbol))
+    return val_error ("set!: cannot set! undefined symbol");
+
+  Node *definition = node->as.definition.value;
+  Value *value = definition->run (definition, environment);
+  ERROR_OUT (value);
+
+  env_update (environment, symbol, value, value_meta (symbol));
+  return symbol;
+}
+
+static Value *
+run_let (Node *node, Environment *environment)
+{
+  for (size_t i = 0; i < node->as.let.count; i++)
+    {
+      Value *symbol = node->as.let.symbols[i];
+      env_set (environment, symbol, val_nil (), value_meta (symbol));
+
+      Node *definition = node->as.let.values[i];
+      Value *value = definition->run (definition, environment);
+      ERROR_OUT (value);
+
+      env_update (environment, symbol, value, value_meta (symbol));
+    }
+
+  return node->as.let.body->run (node->as.let.body, environment);
+}
+
+static Value *
+run_closure (Node *node, Environment *environment)
+{
+  Value *closure = GC_malloc (sizeof (ClosureValue));
+  *AS_CLOSURE (closure) = *AS_CLOSURE (node->as.lambda);
+  AS_CLOSURE (closure)->environment = environment;
+  return closure;
+}
+
+// Body of a closure, compiling it the first time it is called here (the
+// tree-walker's closures and those from before an engine switch).
+static Node *
+closure_body (Value *closure)
+{
+  Compiled *compiled = closure_compiled (closure);
+  if (!compiled->node)
+    {
+      Environment *environment = AS_CLOSURE (closure)->environment;
+      Value *parameters = AS_CLOSURE (closure)->parameters;
+      Value *body = macro_expand_body (environment, parameters,
+                                       AS_CLOSURE (closure)->body);
+
+      compiled->node
+          = compile_function (NULL, environment, parameters, body);
+    }
+
+  return compiled->node;
+}
+
+#define INLINE_ARGUMENTS 8
+
+static Value *
+call (Node *node, Environment *environment, bool tail)
+{
+  Node *head = node->as.call.function;
+  Value *function = head->run (head, environment);
+
+  if (TYPE (function) == VALUE_MACRO && node->as.call.form)
+    return evaluate_expression (environment, node->as.call.form);
+
+  ERROR_OUT (function);
+
+  size_t argc = node->as.call.argc;
+  Value *buffer[INLINE_ARGUMENTS];
+  Value **arguments = argc <= INLINE_ARGUMENTS
+                          ? buffer
+                          : GC_malloc (argc * sizeof (Value *));
+
+  for (size_t i = 0; i < argc; i++)
+    {
+      Node *argument = node->as.call.arguments[i];
+      arguments[i] = argument->run (argument, environment);
+    }
+
+  if (TYPE (function) == VALUE_PRIMITIVE)
+    return call_primitive (function, arguments, argc);
+
+  if (TYPE (function) == VALUE_BUILTIN)
+    return call_builtin (environment, function, arguments, argc);
+
+  if (TYPE (function) != VALUE_LAMBDA)
+    return val_error ("attempt to call non-function");
+
+  Node *body = closure_body (function);
+  Environment *frame = env_init_frame (AS_CLOSURE (function)->environment,
+                                       closure_compiled (function)->frame_size);
+
+  Value *err = bind_values (frame, AS_CLOSURE (function)->parameters,
+                            arguments, argc);
+  ERROR_OUT (err);
+
+  if (tail)
+    {
+      pending_body = body;
+      pending_frame = frame;
+      return &TAIL_CALL;
+    }
+
+  return run_body (body, frame);
+}
+
+static Value *
+run_call (Node *node, Environment *environment)
+{
+  return call (node, environment, false);
+}
+
+static Value *
+run_tail_call (Node *node, Environment *environment)
+{
+  return call (node, environment, true);
+}
+
+static Node *
+node_new (NodeHandler run)
+{
+  Node *node = GC_malloc (sizeof (Node));
+  memset (node, 0, sizeof (Node));
+  node->run = run;
+  return node;
+}
+
+static Node *
+constant_node (Value *value)
+{
+  Node *node = node_new (run_constant);
+  node->as.constant = value;
+  return node;
+}
+
+static Node *
+eval_node (Value *form)
+{
+  Node *node = node_new (run_eval);
+  node->as.form = form;
+  return node;
+}
+
+static Node *
+compile_reference (Context *context, Value *symbol)
+{
+  Node *node;
+  int depth, slot;
+
+  switch (scope_lookup (context->scope, symbol, &depth, &slot))
+    {
+    case REFERENCE_LOCAL:
+      node = node_new (run_local);
+      node->as.local.symbol = symbol;
+      node->as.local.depth = depth;
+      node->as.local.slot = slot;
+      return node;
+
+    case REFERENCE_DYNAMIC:
+      node = node_new (run_name);
+      node->as.global.symbol = symbol;
+      return node;
+
+    case REFERENCE_FREE:
+    default:
+      node = node_new (run_global);
+      node->as.global.symbol = symbol;
+      node->as.global.site = call_site_new (depth);
+      return node;
+    }
+}
+
+// begin, and, or: a single form needs no wrapper
+static Node *
+compile_sequence (Context *context, Value *forms, NodeHandler run, bool tail)
+{
+  size_t count = arguments_length (forms);
+  if (count == 0)
+    return constant_node (val_nil ());
+
+  Node **nodes = GC_malloc (count * sizeof (Node *));
+  for (size_t i = 0; i < count; i++, forms = CDR (forms))
+    nodes[i] = compile (context, CAR (forms), tail && i == count - 1);
+
+  if (count == 1)
+    return nodes[0];
+
+  Node *node = node_new (run);
+  node->as.sequence.nodes = nodes;
+  node->as.sequence.count = count;
+  return node;
+}
+
+static Node *
+compile_lambda (Context *context, Value *parameters, Value *body)
+{
+  Value *lambda = GC_malloc (sizeof (ClosureValue));
+  memset (lambda, 0, sizeof (ClosureValue));
+  lambda->type = VALUE_LAMBDA;
+  AS_CLOSURE (lambda)->parameters = parameters;
+  AS_CLOSURE (lambda)->body = body;
+  closure_compiled (lambda)->node = compile_function (
+      context->scope, context->environment, parameters, body);
+
+  Node *node = node_new (run_closure);
+  node->as.lambda = lambda;
+  return node;
+}
+
+static Node *
+compile_function (Scope *parent, Environment *environment, Value *parameters,
+                  Value *body)
+{
+  Scope scope = scope_init (parent, environment, parameters, body);
+  Context context = { .scope = &scope, .environment = environment };
+
+  return compile_sequence (&context, body, run_sequence, true);
+}
+
+static Node *
+compile_call (Context *context, Value *expression, bool tail)
+{
+  Value *head = CAR (expression);
+  Node *node = node_new (tail ? run_tail_call : run_call);
+
+  int depth, slot;
+  node->as.call.function = compile (context, head, false);
+  if (TYPE (head) == VALUE_SYMBOL
+      && scope_lookup (context->scope, head, &depth, &slot) == REFERENCE_FREE)
+    node->as.call.form = expression;
+
+  Value *arguments = CDR (expression);
+  size_t argc = arguments_length (arguments);
+
+  node->as.call.arguments = GC_malloc ((argc ? argc : 1) * sizeof (Node *));
+  node->as.call.argc = argc;
+  for (size_t i = 0; i < argc; i++, arguments = CDR (arguments))
+    node->as.call.arguments[i] = compile (context, CAR (arguments), false);
+
+  return node;
+}
+
+// The compile_* functions for special forms return NULL for shapes they do
+// not handle; those go to their builtin, which reports the error.
+
+static Node *
+compile_define (Context *context, Value *arguments)
+{
+  if (TYPE (arguments) != VALUE_CONS || TYPE (CDR (arguments)) != VALUE_CONS)
+    return NULL;
+
+  Value *target = CAR (arguments);
+  Value *name = TYPE (target) == VALUE_CONS ? CAR (target) : target;
+  if (TYPE (name) != VALUE_SYMBOL)
+    return NULL;
+
+  Node *node = node_new (run_define);
+  node->as.definition.symbol = name;
+  node->as.definition.value
+      = TYPE (target) == VALUE_CONS
+            ? compile_lambda (context, CDR (target), CDR (arguments))
+            : compile (context, CADR (arguments), false);
+  return node;
+}
+
+static Node *
+compile_set (Context *context, Value *arguments)
+{
+  if (TYPE (arguments) != VALUE_CONS || TYPE (CDR (arguments)) != VALUE_CONS
+      || TYPE (CAR (arguments)) != VALUE_SYMBOL)
+    return NULL;
+
+  Node *node = node_new (run_set);
+  node->as.definition.symbol = CAR (arguments);
+  node->as.definition.value = compile (context, CADR (arguments), false);
+  return node;
+}
+
+static Node *
+compile_let (Context *context, Value *arguments, bool tail)
+{
+  if (TYPE (arguments) != VALUE_CONS)
+    return NULL;
+
+  Value *bindings = CAR (arguments);
+  if (TYPE (bindings) != VALUE_CONS && TYPE (bindings) != VALUE_NIL)
+    return NULL;
+
+  for (Value *b = bindings; TYPE (b) == VALUE_CONS; b = CDR (b))
+    {
+      Value *binding = CAR (b);
+      if (TYPE (binding) != VALUE_CONS || TYPE (CDR (binding)) != VALUE_CONS
+          || TYPE (CAR (binding)) != VALUE_SYMBOL)
+        return NULL;
+    }
+
+  size_t count = arguments_length (bindings);
+  Node *node = node_new (run_let);
+  node->as.let.count = count;
+  node->as.let.symbols = GC_malloc ((count ? count : 1) * sizeof (Value *));
+  node->as.let.values = GC_malloc ((count ? count : 1) * sizeof (Node *));
+
+  for (size_t i = 0; i < count; i++, bindings = CDR (bindings))
+    {
+      node->as.let.symbols[i] = CAAR (bindings);
+      node->as.let.values[i] = compile (context, CADR (CAR (bindings)), false);
+    }
+
+  node->as.let.body
+      = compile_sequence (context, CDR (arguments), run_sequence, tail);
+  return node;
+}
+
+static Node *
+compile_form (Context *context, Value *expression, bool tail)
+{
+  Value *head = CAR (expression);
+  Value *arguments = CDR (expression);
+
+  int depth, slot;
+  SpecialForm form = SPECIAL_NONE;
+  if (TYPE (head) == VALUE_SYMBOL)
+    switch (scope_lookup (context->scope, head, &depth, &slot))
+      {
+      case REFERENCE_FREE:
+        form = special_form (head);
+        break;
+
+      case REFERENCE_DYNAMIC:
+        // in an open scope a special form may still be rebound at run time:
+        // only the tree-walker can tell, so it gets the whole form
+        if (special_form (head) != SPECIAL_NONE)
+          return eval_node (expression);
+        break;
+
+      case REFERENCE_LOCAL:
+        break;
+      }
+
+  Node *node = NULL;
+  switch (form)
+    {
+    case SPECIAL_NONE:
+      return compile_call (context, expression, tail);
+
+    case SPECIAL_QUOTE:
+      if (arguments_length (arguments) == 1)
+        node = constant_node (CAR (arguments));
+      break;
+
+    case SPECIAL_IF:
+      if (arguments_length (arguments) == 3)
+        {
+          node = node_new (run_if);
+          node->as.branch.condition
+              = compile (context, CAR (arguments), false);
+          node->as.branch.then = compile (context, CADR (arguments), tail);
+          node->as.branch.otherwise
+              = compile (context, CADR (CDR (arguments)), tail);
+        }
+      break;
+
+    case SPECIAL_BEGIN:
+      return compile_sequence (context, arguments, run_sequence, tail);
+
+    case SPECIAL_AND:
+    case SPECIAL_OR:
+      if (arguments_length (arguments) > 0)
+        node = compile_sequence (context, arguments,
+                                 form == SPECIAL_AND ? run_and : run_or,
+                                 tail);
+      break;
+
+    case SPECIAL_LAMBDA:
+      if (TYPE (arguments) == VALUE_CONS)
+        node = compile_lambda (context, CAR (arguments), CDR (arguments));
+      break;
+
+    case SPECIAL_DEFINE:
+      node = compile_define (context, arguments);
+      break;
+
+    case SPECIAL_SET:
+      node = compile_set (context, arguments);
+      break;
+
+    case SPECIAL_LET:
+    case SPECIAL_LET_STAR:
+      node = compile_let (context, arguments, tail);
+      break;
+
+    default:
+      break;
+    }
+
+  return node ? node : eval_node (expression);
+}
+
+static Node *
+compile (Context *context, Value *expression, bool tail)
+{
+  switch (TYPE (expression))
+    {
+    case VALUE_CONS:
+      return compile_form (context, expression, tail);
+
+    case VALUE_SYMBOL:
+      return compile_reference (context, expression);
+
+    case VALUE_LOCAL:
+      return compile_reference (context, AS_LOCAL (expression)->symbol);
+
+    case VALUE_MODULE_REFERENCE:
+      {
+        Node *node = node_new (run_module_reference);
+        node->as.reference = expression;
+        return node;
+      }
+
+    default:
+      return constant_node (expression);
+    }
+}
+
+Value *
+node_evaluate (Environment *environment, Value *expression)
+{
+  if (TYPE (expression) == VALUE_CONS
+      && special_form (CAR (expression)) == SPECIAL_BEGIN)
+    {
+      Value *result = val_nil ();
+      for (Value *forms = CDR (expression); TYPE (forms) == VALUE_CONS;
+           forms = CDR (forms))
+        {
+          result = node_evaluate (environment, CAR (forms));
+          ERROR_OUT (result);
+        }
+
+      return result;
+    }
+
+  Context context = { .scope = NULL, .environment = environment };
+  Node *node
+      = compile (&context, macro_expand_all (environment, expression), true);
+
+  return run_body (node, environment);
+}
@@ -1,38 +1,29 @@
 #include "core/quasiquote.h"
+#include "core/symbol_map.h"
 #include "core/value.h"
 
-static const Meta QQ_EXPAND_META
-    = { .filename = "<quasiquote-expanded>", .line_number = 0 };
-
-static int
-is_symbol_named (Value *node, const char *name)
-{
-  return node->type == VALUE_SYMBOL && strcmp (node->as.SYMBOL, name) == 0;
-}
-
 static int
 is_unquote (Value *node)
 {
-  return node->type == VALUE_CONS && is_symbol_named (CAR (node), "unquote")
+  return TYPE (node) == VALUE_CONS && CAR (node) == CORE_SYMBOL (UNQUOTE)
          && !IS_NULL (CDR (node)) && IS_NULL (CDDR (node));
 }
 
 static int
 is_unquote_splicing (Value *node)
 {
-  return node->type == VALUE_CONS
-         && is_symbol_named (CAR (node), "unquote-splicing")
+  return TYPE (node) == VALUE_CONS
+         && CAR (node) == CORE_SYMBOL (UNQUOTE_SPLICING)
          && !IS_NULL (CDR (node)) && IS_NULL (CDDR (node));
 }
 
 Value *
 expand_quasiquote (Value *expr, int depth)
 {
-  if (expr->type != VALUE_CONS)
+  if (TYPE (expr) != VALUE_CONS)
     {
       // Basic types (integers, strings, or symbols) get quoted
-      return val_cons (val_symbol ("quote", QQ_EXPAND_META),
-                       val_cons (expr, val_nil ()));
+      return val_cons (CORE_SYMBOL (QUOTE), val_cons (expr, val_nil ()));
     }
 
   // Handle ,expression
@@ -42,10 +33,9 @@ expand_quasiquote (Value *expr, int depth)
         return CADR (expr);
       // If nested, we stay in quasiquote mode
       return val_cons (
-          val_symbol ("list", QQ_EXPAND_META),
-          val_cons (val_cons (val_symbol ("quote", QQ_EXPAND_META),
-                              val_cons (val_symbol ("unquote", QQ_EXPAND_META),
-                                        val_nil ())),
+          CORE_SYMBOL (LIST),
+          val_cons (val_cons (CORE_SYMBOL (QUOTE),
+                              val_cons (CORE_SYMBOL (UNQUOTE), val_nil ())),
                     val_cons (expand_quasiquote (CADR (expr), depth - 1),
                               val_nil ())));
     }
@@ -55,7 +45,7 @@ expand_quasiquote (Value *expr, int depth)
   if (is_unquote_splicing (head) && depth == 1)
     {
       // This turns `(,@a . b) into (append a `b)
-      return val_cons (val_symbol ("append", QQ_EXPAND_META),
+      return val_cons (CORE_SYMBOL (APPEND),
                        val_cons (CADR (head), val_cons (expand_quasiquote (
                                                             CDR (expr), depth),
                                                         val_nil ())));
@@ -64,7 +54,7 @@ expand_quasiquote (Value *expr, int depth)
   // Handle standard ( head . rest )
   // This turns `(a . b) into (cons `a `b)
   return val_cons (
-      val_symbol ("cons", QQ_EXPAND_META),
+      CORE_SYMBOL (CONS),
       val_cons (expand_quasiquote (head, depth),
                 val_cons (expand_quasiquote (CDR (expr), depth), val_nil ())));
 }
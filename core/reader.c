@@ -0,0 +1,386 @@
+#include "core/reader.h"
+#include "core/symbol_map.h"
+
+#include <gc/gc.h>
+#include <limits.h>
+
+typedef enum
+{
+  FRAME_LIST,   // inside '(' ... ')'
+  FRAME_DOTTED, // after the '.' of a list, waiting for its cdr
+  FRAME_CLOSED, // dotted list that has its cdr, waiting for ')'
+  FRAME_PREFIX, // after ' ` , or ,@, waiting for the datum it applies to
+} FrameKind;
+
+typedef struct
+{
+  FrameKind kind;
+  Value *head; // list read so far, or the symbol a prefix stands for
+  Value *tail; // last cons of head
+} Frame;
+
+typedef struct
+{
+  Frame *frames;
+  size_t size;
+  size_t capacity;
+} Stack;
+
+Reader
+reader_init (Lexer *lexer)
+{
+  Reader reader = { 0 };
+  reader.lexer = lexer;
+  reader.token = lexer_next_token (lexer);
+  return reader;
+}
+
+Reader
+reader_from_data (Value *data, const uint64_t *hashes)
+{
+  Reader reader = { 0 };
+  reader.data = data;
+  reader.hashes = hashes;
+  return reader;
+}
+
+#define HASH_SEED 0xcbf29ce484222325u
+#define HASH_PRIME 0x100000001b3u
+
+static uint64_t
+hash_token (uint64_t hash, const Token *token)
+{
+  hash = (hash ^ token->type) * HASH_PRIME;
+  for (size_t i = 0; i < token->length; i++)
+    hash = (hash ^ (unsigned char)token->text[i]) * HASH_PRIME;
+  return hash;
+}
+
+static void
+advance (Reader *reader)
+{
+  reader->token = lexer_next_token (reader->lexer);
+}
+
+static void
+push (Stack *stack, FrameKind kind, Value *head)
+{
+  if (stack->size == stack->capacity)
+    {
+      size_t capacity = stack->capacity ? stack->capacity * 2 : 16;
+      Frame *frames = GC_malloc (capacity * sizeof (Frame));
+      if (stack->size)
+        memcpy (frames, stack->frames, stack->size * sizeof (Frame));
+      stack->frames = frames;
+      stack->capacity = capacity;
+    }
+
+  stack->frames[stack->size++]
+      = (Frame){ .kind = kind, .head = head, .tail = NULL };
+}
+
+static Value *
+read_error (Reader *reader, Token *token, const char *message)
+{
+  Value *error = val_error ("read: %s (%s:%zu)", message,
+                            reader->lexer->filename, token->line);
+
+  reader->error.status = ERROR;
+  reader->error.message = AS_ERROR (error)->MESSAGE;
+  reader->error.filename = reader->lexer->filename;
+  reader->error.line = token->line;
+  reader->error.column = token->column;
+  return error;
+}
+
+static Value *
+read_symbol (Reader *reader, Token *token)
+{
+  Meta meta = {
+    .filename = reader->lexer->filename,
+    .line_number = token->line,
+  };
+
+  const char *slash = memchr (token->text, '/', token->length);
+  if (slash)
+    { // module/symbol
+      size_t module_length = slash - token->text;
+      Value *module = val_symbol_slice (token->text, module_length, meta);
+      Value *symbol = val_symbol_slice (slash + 1,
+                                        token->length - module_length - 1,
+                                        meta);
+      return val_cons (
+          CORE_SYMBOL (GET_FROM_MODULE),
+          val_cons (module, val_cons (symbol, val_nil ())));
+    }
+
+  return val_symbol_slice (token->text, token->length, meta);
+}
+
+// Digits with an optional leading '-', clamped to the range of long like
+// strtol
+static long
+read_integer (const char *text, size_t length)
+{
+  bool negative = length > 0 && text[0] == '-';
+  unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+  unsigned long value = 0;
+
+  for (size_t i = negative; i < length; i++)
+    {
+      unsigned digit = text[i] - '0';
+      if (value > (limit - digit) / 10)
+        {
+          value = limit;
+          break;
+        }
+      value = value * 10 + digit;
+    }
+
+  return negative ? (long)(0 - value) : (long)value;
+}
+
+static double
+read_float (const char *text, size_t length)
+{
+  // strtod needs a terminated string, and could read past the token
+  char buffer[64];
+  char *digits = length < sizeof (buffer) ? buffer
+                                          : GC_malloc_atomic (length + 1);
+  memcpy (digits, text, length);
+  digits[length] = '\0';
+
+  return strtod (digits, NULL);
+}
+
+static Value *
+read_atom (Reader *reader, Token *token)
+{
+  switch (token->type)
+    {
+    case TOKEN_INTEGER:
+      return val_integer (read_integer (token->text, token->length));
+    case TOKEN_FLOAT:
+      return val_float (read_float (token->text, token->length));
+    case TOKEN_STRING:
+      {
+        char *string = GC_malloc_atomic (token->length + 1);
+        lexer_unescape (token->text, token->length, string);
+        return val_string_take (string);
+      }
+    default:
+      return read_symbol (reader, token);
+    }
+}
+
+Value *
+reader_next (Reader *reader)
+{
+  if (!reader->lexer)
+    {
+      if (TYPE (reader->data) != VALUE_CONS)
+        return NULL;
+
+      Value *datum = CAR (reader->data);
+      reader->data = CDR (reader->data);
+      reader->hash = reader->hashes ? *reader->hashes++ : 0;
+      return datum;
+    }
+
+  Stack stack = { 0 };
+  uint64_t hash = HASH_SEED;
+
+  while (true)
+    {
+      Token token = reader->token;
+      hash = hash_token (hash, &token);
+      Frame *top = stack.size ? &stack.frames[stack.size - 1] : NULL;
+      Value *datum = NULL;
+
+      if (top && top->kind == FRAME_CLOSED
+          && token.type != TOKEN_CLOSE_PAREN)
+        return read_error (reader, &token, "expected ')' after dotted pair");
+
+      switch (token.type)
+        {
+        case TOKEN_END_OF_FILE:
+          if (top)
+            return read_error (reader, &token, top->kind == FRAME_PREFIX
+                                                   ? "unexpected end of input"
+                                                   : "unterminated list");
+          return NULL;
+
+        case TOKEN_OPEN_PAREN:
+          advance (reader);
+          push (&stack, FRAME_LIST, val_nil ());
+          continue;
+
+        case TOKEN_CLOSE_PAREN:
+          if (!top || top->kind == FRAME_PREFIX || top->kind == FRAME_DOTTED)
+            return read_error (reader, &token, "unexpected ')'");
+          advance (reader);
+          datum = top->head;
+          stack.size--;
+          break;
+
+        case TOKEN_PERIOD:
+          if (!top || top->kind != FRAME_LIST || !top->tail)
+            return read_error (reader, &token, "unexpected '.'");
+          advance (reader);
+          top->kind = FRAME_DOTTED;
+          continue;
+
+        case TOKEN_QUOTE:
+          advance (reader);
+          push (&stack, FRAME_PREFIX, CORE_SYMBOL (QUOTE));
+          continue;
+        case TOKEN_QUASIQUOTE:
+          advance (reader);
+          push (&stack, FRAME_PREFIX, CORE_SYMBOL (QUASIQUOTE));
+          continue;
+        case TOKEN_UNQUOTE:
+          advance (reader);
+          push (&stack, FRAME_PREFIX, CORE_SYMBOL (UNQUOTE));
+          continue;
+        case TOKEN_UNQUOTE_SPLICING:
+          advance (reader);
+          push (&stack, FRAME_PREFIX, CORE_SYMBOL (UNQUOTE_SPLICING));
+          continue;
+
+        case TOKEN_INTEGER:
+        case TOKEN_FLOAT:
+        case TOKEN_STRING:
+        case TOKEN_SYMBOL:
+          advance (reader);
+          datum = read_atom (reader, &token);
+          break;
+
+        default:
+          advance (reader);
+          return read_error (reader, &token, "unexpected character");
+        }
+
+      // hand the datum to the innermost frame waiting for one, finishing
+      // any prefixes in the way
+      while (stack.size)
+        {
+          Frame *frame = &stack.frames[stack.size - 1];
+
+          if (frame->kind == FRAME_PREFIX)
+            {
+              datum = val_cons (frame->head, val_cons (datum, val_nil ()));
+              stack.size--;
+              continue;
+            }
+
+          if (frame->kind == FRAME_DOTTED)
+            {
+              CDR (frame->tail) = datum;
+              frame->kind = FRAME_CLOSED;
+            }
+          else
+            {
+              Value *cell = val_cons (datum, val_nil ());
+              if (frame->tail)
+                CDR (frame->tail) = cell;
+              else
+                frame->head = cell;
+              frame->tail = cell;
+            }
+          break;
+        }
+
+      if (!stack.size)
+        {
+          reader->hash = hash;
+          if (reader->cache)
+            code_cache_writer_add (reader->cache, datum, hash);
+          return datum;
+        }
+    }
+}
+
+bool
+reader_skip (Reader *reader, uint64_t *hash, Lexer *next)
+{
+  // only the nesting is followed: a datum ends with an atom or ')' outside
+  // of any list, and not right after a prefix
+  size_t depth = 0;
+  bool started = false;
+  *hash = HASH_SEED;
+
+  while (true)
+    {
+      Token token = reader->token;
+      *hash = hash_token (*hash, &token);
+
+      bool last;
+      switch (token.type)
+        {
+        case TOKEN_END_OF_FILE:
+          if (started)
+            read_error (reader, &token, depth ? "unterminated list"
+                                              : "unexpected end of input");
+          return false;
+
+        case TOKEN_OPEN_PAREN:
+          depth++;
+          last = false;
+          break;
+
+        case TOKEN_CLOSE_PAREN:
+          if (!depth)
+            {
+              read_error (reader, &token, "unexpected ')'");
+              return false;
+            }
+          last = --depth == 0;
+          break;
+
+        case TOKEN_PERIOD:
+        case TOKEN_QUOTE:
+        case TOKEN_QUASIQUOTE:
+        case TOKEN_UNQUOTE:
+        case TOKEN_UNQUOTE_SPLICING:
+          last = false;
+          break;
+
+        case TOKEN_INTEGER:
+        case TOKEN_FLOAT:
+        case TOKEN_STRING:
+        case TOKEN_SYMBOL:
+          last = depth == 0;
+          break;
+
+        default:
+          read_error (reader, &token, "unexpected character");
+          return false;
+        }
+
+      if (last)
+        *next = *reader->lexer;
+      advance (reader);
+      if (last)
+        return true;
+      started = true;
+    }
+}
+
+Value *
+reader_read_program (Reader *reader)
+{
+  Value *program = val_cons (CORE_SYMBOL (BEGIN), val_nil ());
+  Value *tail = program;
+
+  Value *datum;
+  while ((datum = reader_next (reader)))
+    {
+      if (TYPE (datum) == VALUE_ERROR)
+        return datum;
+
+      CDR (tail) = val_cons (datum, val_nil ());
+      tail = CDR (tail);
+    }
+
+  return program;
+}
@@ -0,0 +1,331 @@
+#include "core/resolve.h"
+#include "core/eval.h"
+#include "core/expand.h"
+#include "core/special_form.h"
+
+#include <stdbool.h>
+
+typedef enum
+{
+  FORM_CALL,
+  FORM_QUOTE,  // arguments are data or raw symbols, never rewritten
+  FORM_LAMBDA, // (lambda params . body)
+  FORM_DEFINE, // (define name expr) or (define (name . params) . body)
+  FORM_SET,    // (set! name expr)
+  FORM_LET,    // (let ((name expr) ...) . body), same for let*
+  FORM_DEFMACRO,
+  FORM_EVAL, // evaluates code we cannot see, arguments are ordinary
+} FormKind;
+
+static void resolve_body (Scope *scope, Environment *environment,
+                          Value *body);
+static Value *resolve_expression (Scope *scope, Environment *environment,
+                                  Value *expression);
+static void collect_dynamic (Scope *scope, Environment *environment,
+                             Value *expression);
+
+static int
+parameter_slot (Value *parameters, Value *symbol)
+{
+  int slot = 0;
+
+  for (; TYPE (parameters) == VALUE_CONS; parameters = CDR (parameters))
+    {
+      if (CAR (parameters) == symbol)
+        return slot;
+      slot++;
+    }
+
+  if (parameters == symbol)
+    return slot;
+
+  return -1;
+}
+
+static bool
+is_member (Value *list, Value *symbol)
+{
+  for (; TYPE (list) == VALUE_CONS; list = CDR (list))
+    if (CAR (list) == symbol)
+      return true;
+
+  return false;
+}
+
+static void
+mark_dynamic (Scope *scope, Value *symbol)
+{
+  if (TYPE (symbol) == VALUE_SYMBOL && !is_member (scope->dynamic, symbol))
+    scope->dynamic = val_cons (symbol, scope->dynamic);
+}
+
+ReferenceKind
+scope_lookup (Scope *scope, Value *symbol, int *depth, int *slot)
+{
+  for (*depth = 0; scope; scope = scope->parent, (*depth)++)
+    {
+      *slot = parameter_slot (scope->parameters, symbol);
+      if (*slot >= 0)
+        return REFERENCE_LOCAL;
+
+      if (scope->open || is_member (scope->dynamic, symbol))
+        return REFERENCE_DYNAMIC;
+    }
+
+  return REFERENCE_FREE;
+}
+
+static FormKind
+form_kind (Scope *scope, Value *head)
+{
+  int depth, slot;
+  if (TYPE (head) != VALUE_SYMBOL
+      || scope_lookup (scope, head, &depth, &slot) == REFERENCE_LOCAL)
+    return FORM_CALL;
+
+  switch (special_form (head))
+    {
+    case SPECIAL_QUOTE:
+    case SPECIAL_QUASIQUOTE:
+    case SPECIAL_MACRO:
+    case SPECIAL_RAW:
+      return FORM_QUOTE;
+    case SPECIAL_LAMBDA:
+      return FORM_LAMBDA;
+    case SPECIAL_DEFINE:
+      return FORM_DEFINE;
+    case SPECIAL_DEFMACRO:
+      return FORM_DEFMACRO;
+    case SPECIAL_SET:
+      return FORM_SET;
+    case SPECIAL_LET:
+    case SPECIAL_LET_STAR:
+      return FORM_LET;
+    case SPECIAL_EVAL:
+      return FORM_EVAL;
+    default:
+      return FORM_CALL;
+    }
+}
+
+static bool
+is_macro_call (Environment *environment, Value *head)
+{
+  if (TYPE (head) != VALUE_SYMBOL)
+    return false;
+
+  Binding *binding = env_get_binding (environment, head);
+  return binding && TYPE (binding->value) == VALUE_MACRO;
+}
+
+Scope
+scope_init (Scope *parent, Environment *environment, Value *parameters,
+            Value *body)
+{
+  Scope scope = { .parent = parent,
+                  .parameters = parameters,
+                  .dynamic = val_nil (),
+                  .open = false };
+
+  for (; TYPE (body) == VALUE_CONS; body = CDR (body))
+    collect_dynamic (&scope, environment, CAR (body));
+
+  return scope;
+}
+
+// First pass over a lambda body: find every name the body can add to its
+// own frame. Nested lambdas get frames of their own and are skipped.
+static void
+collect_dynamic (Scope *scope, Environment *environment, Value *expression)
+{
+  if (TYPE (expression) != VALUE_CONS)
+    return;
+
+  Value *head = CAR (expression);
+  Value *arguments = CDR (expression);
+
+  switch (form_kind (scope, head))
+    {
+    case FORM_QUOTE:
+    case FORM_LAMBDA:
+      return;
+
+    case FORM_DEFINE:
+    case FORM_DEFMACRO:
+      if (TYPE (arguments) != VALUE_CONS)
+        return;
+      if (TYPE (CAR (arguments)) == VALUE_CONS)
+        {
+          mark_dynamic (scope, CAAR (arguments));
+          return;
+        }
+      mark_dynamic (scope, CAR (arguments));
+      arguments = CDR (arguments);
+      break;
+
+    case FORM_SET:
+      if (TYPE (arguments) != VALUE_CONS)
+        return;
+      mark_dynamic (scope, CAR (arguments));
+      arguments = CDR (arguments);
+      break;
+
+    case FORM_LET:
+      if (TYPE (arguments) != VALUE_CONS)
+        return;
+      for (Value *bindings = CAR (arguments); TYPE (bindings) == VALUE_CONS;
+           bindings = CDR (bindings))
+        {
+          Value *binding = CAR (bindings);
+          if (TYPE (binding) != VALUE_CONS)
+            continue;
+
+          mark_dynamic (scope, CAR (binding));
+          for (Value *rest = CDR (binding); TYPE (rest) == VALUE_CONS;
+               rest = CDR (rest))
+            collect_dynamic (scope, environment, CAR (rest));
+        }
+      arguments = CDR (arguments);
+      break;
+
+    case FORM_EVAL:
+      scope->open = true;
+      break;
+
+    case FORM_CALL:
+      if (is_macro_call (environment, head))
+        {
+          scope->open = true;
+          return;
+        }
+      collect_dynamic (scope, environment, head);
+      break;
+    }
+
+  for (; TYPE (arguments) == VALUE_CONS; arguments = CDR (arguments))
+    collect_dynamic (scope, environment, CAR (arguments));
+}
+
+static void
+resolve_lambda_form (Scope *scope, Environment *environment,
+                     Value *parameters, Value *body)
+{
+  if (TYPE (body) != VALUE_CONS)
+    return;
+
+  Scope inner = scope_init (scope, environment, parameters, body);
+  resolve_body (&inner, environment, body);
+}
+
+static void
+resolve_arguments (Scope *scope, Environment *environment, Value *arguments)
+{
+  for (; TYPE (arguments) == VALUE_CONS; arguments = CDR (arguments))
+    CAR (arguments) = resolve_expression (scope, environment, CAR (arguments));
+}
+
+static void
+resolve_form (Scope *scope, Environment *environment, Value *expression)
+{
+  Value *head = CAR (expression);
+  Value *arguments = CDR (expression);
+
+  int depth, slot;
+  if (TYPE (head) == VALUE_SYMBOL && expression->flags & VALUE_FLAG_CODE
+      && !AS_CODE (expression)->SITE
+      && scope_lookup (scope, head, &depth, &slot) == REFERENCE_FREE)
+    AS_CODE (expression)->SITE = call_site_new (depth);
+
+  switch (form_kind (scope, head))
+    {
+    case FORM_QUOTE:
+    case FORM_DEFMACRO:
+      return;
+
+    case FORM_LAMBDA:
+      if (TYPE (arguments) == VALUE_CONS)
+        resolve_lambda_form (scope, environment, CAR (arguments),
+                             CDR (arguments));
+      return;
+
+    case FORM_DEFINE:
+      if (TYPE (arguments) != VALUE_CONS)
+        return;
+      if (TYPE (CAR (arguments)) == VALUE_CONS)
+        resolve_lambda_form (scope, environment, CDAR (arguments),
+                             CDR (arguments));
+      else
+        resolve_arguments (scope, environment, CDR (arguments));
+      return;
+
+    case FORM_SET:
+      if (TYPE (arguments) == VALUE_CONS)
+        resolve_arguments (scope, environment, CDR (arguments));
+      return;
+
+    case FORM_LET:
+      if (TYPE (arguments) != VALUE_CONS)
+        return;
+      for (Value *bindings = CAR (arguments); TYPE (bindings) == VALUE_CONS;
+           bindings = CDR (bindings))
+        if (TYPE (CAR (bindings)) == VALUE_CONS)
+          resolve_arguments (scope, environment, CDAR (bindings));
+      resolve_arguments (scope, environment, CDR (arguments));
+      return;
+
+    case FORM_EVAL:
+      resolve_arguments (scope, environment, arguments);
+      return;
+
+    case FORM_CALL:
+      if (is_macro_call (environment, head))
+        return;
+      CAR (expression) = resolve_expression (scope, environment, head);
+      resolve_arguments (scope, environment, arguments);
+      return;
+    }
+}
+
+static Value *
+resolve_expression (Scope *scope, Environment *environment, Value *expression)
+{
+  switch (TYPE (expression))
+    {
+    case VALUE_SYMBOL:
+      {
+        int depth, slot;
+        if (scope_lookup (scope, expression, &depth, &slot) == REFERENCE_LOCAL)
+          return val_local (expression, depth, slot);
+        return expression;
+      }
+
+    case VALUE_CONS:
+      resolve_form (scope, environment, expression);
+      return expression;
+
+    default:
+      return expression;
+    }
+}
+
+static void
+resolve_body (Scope *scope, Environment *environment, Value *body)
+{
+  body->flags |= VALUE_FLAG_RESOLVED;
+  resolve_arguments (scope, environment, body);
+}
+
+Value *
+resolve_lambda (Environment *environment, Value *parameters, Value *body)
+{
+  if (TYPE (body) != VALUE_CONS || body->flags & VALUE_FLAG_RESOLVED)
+    return body;
+
+  // a body that is not the expander's code (a lambda handed to eval as
+  // data) is resolved in a copy, the program may still hold the original
+  if (!(body->flags & VALUE_FLAG_CODE))
+    body = macro_expand_body (environment, parameters, body);
+
+  resolve_lambda_form (NULL, environment, parameters, body);
+  return body;
+}
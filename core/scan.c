@@ -0,0 +1,317 @@
+#include "core/scan.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+// bytes that end a symbol, besides NUL
+static const char DELIMITERS[] = " \t\n\r()[]\";,'`|\\@";
+
+// must agree with DELIMITERS
+const unsigned char char_class[256] = {
+  [0] = CHAR_DELIMITER | CHAR_STRING_STOP,
+
+  [' '] = CHAR_DELIMITER | CHAR_SPACE,
+  ['\t'] = CHAR_DELIMITER | CHAR_SPACE,
+  ['\r'] = CHAR_DELIMITER | CHAR_SPACE,
+  ['\n'] = CHAR_DELIMITER | CHAR_SPACE | CHAR_STRING_STOP,
+
+  ['('] = CHAR_DELIMITER,
+  [')'] = CHAR_DELIMITER,
+  ['['] = CHAR_DELIMITER,
+  [']'] = CHAR_DELIMITER,
+  ['"'] = CHAR_DELIMITER | CHAR_STRING_STOP,
+  [';'] = CHAR_DELIMITER,
+  [','] = CHAR_DELIMITER,
+  ['\''] = CHAR_DELIMITER,
+  ['`'] = CHAR_DELIMITER,
+  ['|'] = CHAR_DELIMITER,
+  ['\\'] = CHAR_DELIMITER | CHAR_STRING_STOP,
+  ['@'] = CHAR_DELIMITER,
+
+  ['.'] = CHAR_NUMBER,
+  ['0'] = CHAR_NUMBER,
+  ['1'] = CHAR_NUMBER,
+  ['2'] = CHAR_NUMBER,
+  ['3'] = CHAR_NUMBER,
+  ['4'] = CHAR_NUMBER,
+  ['5'] = CHAR_NUMBER,
+  ['6'] = CHAR_NUMBER,
+  ['7'] = CHAR_NUMBER,
+  ['8'] = CHAR_NUMBER,
+  ['9'] = CHAR_NUMBER,
+};
+
+// bytes up to the first one in class
+static size_t
+scalar_until (const char *text, size_t length, unsigned char class)
+{
+  size_t i = 0;
+  while (i < length && !CHAR_IS (text[i], class))
+    i++;
+  return i;
+}
+
+// bytes up to the first one not in class
+static size_t
+scalar_while (const char *text, size_t length, unsigned char class)
+{
+  size_t i = 0;
+  while (i < length && CHAR_IS (text[i], class))
+    i++;
+  return i;
+}
+
+static size_t
+scalar_string (const char *text, size_t length)
+{
+  return scalar_until (text, length, CHAR_STRING_STOP);
+}
+
+static size_t
+scalar_whitespace (const char *text, size_t length)
+{
+  return scalar_while (text, length, CHAR_SPACE);
+}
+
+static size_t
+scalar_symbol (const char *text, size_t length)
+{
+  return scalar_until (text, length, CHAR_DELIMITER);
+}
+
+static size_t
+scalar_number (const char *text, size_t length)
+{
+  return scalar_while (text, length, CHAR_NUMBER);
+}
+
+typedef struct
+{
+  size_t (*whitespace) (const char *text, size_t length);
+  size_t (*symbol) (const char *text, size_t length);
+  size_t (*number) (const char *text, size_t length);
+  size_t (*string) (const char *text, size_t length);
+} Scanner;
+
+static const Scanner SCALAR = {
+  scalar_whitespace,
+  scalar_symbol,
+  scalar_number,
+  scalar_string,
+};
+
+#ifdef SCAN_X86
+
+// The body of a vector scan: find the first block in which stop() marks a
+// byte, and finish the last partial block with the scalar version.
+#define VECTOR_SCAN(width, vector, load, stop, scalar)                        \
+  size_t i = 0;                                                               \
+  for (; i + (width) <= length; i += (width))                                 \
+    {                                                                         \
+      unsigned mask = stop (load ((const vector *)(text + i)));               \
+      if (mask)                                                               \
+        return i + __builtin_ctz (mask);                                      \
+    }                                                                         \
+  return i + scalar (text + i, length - i)
+
+// SSE2, 16 bytes at a time. The stop functions give a bit per byte that
+// ends the run.
+
+static inline __m128i
+sse2_any_of (__m128i v, const char *set, size_t count)
+{
+  __m128i found = _mm_setzero_si128 ();
+  for (size_t k = 0; k < count; k++)
+    found = _mm_or_si128 (found, _mm_cmpeq_epi8 (v, _mm_set1_epi8 (set[k])));
+  return found;
+}
+
+static inline unsigned
+sse2_whitespace_stop (__m128i v)
+{
+  return ~_mm_movemask_epi8 (sse2_any_of (v, " \t\r\n", 4)) & 0xFFFF;
+}
+
+static inline unsigned
+sse2_symbol_stop (__m128i v)
+{
+  __m128i stop = _mm_or_si128 (
+      _mm_cmpeq_epi8 (v, _mm_setzero_si128 ()),
+      sse2_any_of (v, DELIMITERS, sizeof (DELIMITERS) - 1));
+  return _mm_movemask_epi8 (stop);
+}
+
+static inline unsigned
+sse2_number_stop (__m128i v)
+{
+  // signed compares, so bytes from 0x80 up are below '0'
+  __m128i digit = _mm_and_si128 (_mm_cmpgt_epi8 (v, _mm_set1_epi8 ('0' - 1)),
+                                 _mm_cmplt_epi8 (v, _mm_set1_epi8 ('9' + 1)));
+  __m128i number = _mm_or_si128 (digit, _mm_cmpeq_epi8 (v, _mm_set1_epi8 ('.')));
+  return ~_mm_movemask_epi8 (number) & 0xFFFF;
+}
+
+// the 4 bytes of "\"\\\n" include its NUL
+static inline unsigned
+sse2_string_stop (__m128i v)
+{
+  return _mm_movemask_epi8 (sse2_any_of (v, "\"\\\n", 4));
+}
+
+static size_t
+sse2_whitespace (const char *text, size_t length)
+{
+  VECTOR_SCAN (16, __m128i, _mm_loadu_si128, sse2_whitespace_stop,
+               scalar_whitespace);
+}
+
+static size_t
+sse2_symbol (const char *text, size_t length)
+{
+  VECTOR_SCAN (16, __m128i, _mm_loadu_si128, sse2_symbol_stop, scalar_symbol);
+}
+
+static size_t
+sse2_number (const char *text, size_t length)
+{
+  VECTOR_SCAN (16, __m128i, _mm_loadu_si128, sse2_number_stop, scalar_number);
+}
+
+static size_t
+sse2_string (const char *text, size_t length)
+{
+  VECTOR_SCAN (16, __m128i, _mm_loadu_si128, sse2_string_stop, scalar_string);
+}
+
+static const Scanner SSE2 = {
+  sse2_whitespace,
+  sse2_symbol,
+  sse2_number,
+  sse2_string,
+};
+
+// AVX2, the same 32 bytes at a time
+
+#define AVX2 __attribute__ ((target ("avx2")))
+
+static inline AVX2 __m256i
+avx2_any_of (__m256i v, const char *set, size_t count)
+{
+  __m256i found = _mm256_setzero_si256 ();
+  for (size_t k = 0; k < count; k++)
+    found = _mm256_or_si256 (found,
+                             _mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (set[k])));
+  return found;
+}
+
+static inline AVX2 unsigned
+avx2_whitespace_stop (__m256i v)
+{
+  return ~(unsigned)_mm256_movemask_epi8 (avx2_any_of (v, " \t\r\n", 4));
+}
+
+static inline AVX2 unsigned
+avx2_symbol_stop (__m256i v)
+{
+  __m256i stop = _mm256_or_si256 (
+      _mm256_cmpeq_epi8 (v, _mm256_setzero_si256 ()),
+      avx2_any_of (v, DELIMITERS, sizeof (DELIMITERS) - 1));
+  return _mm256_movemask_epi8 (stop);
+}
+
+static inline AVX2 unsigned
+avx2_number_stop (__m256i v)
+{
+  __m256i digit
+      = _mm256_and_si256 (_mm256_cmpgt_epi8 (v, _mm256_set1_epi8 ('0' - 1)),
+                          _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('9' + 1), v));
+  __m256i number
+      = _mm256_or_si256 (digit, _mm256_cmpeq_epi8 (v, _mm256_set1_epi8 ('.')));
+  return ~(unsigned)_mm256_movemask_epi8 (number);
+}
+
+static inline AVX2 unsigned
+avx2_string_stop (__m256i v)
+{
+  return _mm256_movemask_epi8 (avx2_any_of (v, "\"\\\n", 4));
+}
+
+static AVX2 size_t
+avx2_whitespace (const char *text, size_t length)
+{
+  VECTOR_SCAN (32, __m256i, _mm256_loadu_si256, avx2_whitespace_stop,
+               scalar_whitespace);
+}
+
+static AVX2 size_t
+avx2_symbol (const char *text, size_t length)
+{
+  VECTOR_SCAN (32, __m256i, _mm256_loadu_si256, avx2_symbol_stop,
+               scalar_symbol);
+}
+
+static AVX2 size_t
+avx2_number (const char *text, size_t length)
+{
+  VECTOR_SCAN (32, __m256i, _mm256_loadu_si256, avx2_number_stop,
+               scalar_number);
+}
+
+static AVX2 size_t
+avx2_string (const char *text, size_t length)
+{
+  VECTOR_SCAN (32, __m256i, _mm256_loadu_si256, avx2_string_stop,
+               scalar_string);
+}
+
+static const Scanner AVX2_SCANNER = {
+  avx2_whitespace,
+  avx2_symbol,
+  avx2_number,
+  avx2_string,
+};
+
+#endif // SCAN_X86
+
+static const Scanner *scanner = NULL;
+
+static const Scanner *
+select_scanner (void)
+{
+#ifdef SCAN_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return &AVX2_SCANNER;
+  if (__builtin_cpu_supports ("sse2"))
+    return &SSE2;
+#endif
+  return &SCALAR;
+}
+
+#define SCANNER() (scanner ? scanner : (scanner = select_scanner ()))
+
+size_t
+scan_whitespace (const char *text, size_t length)
+{
+  return SCANNER ()->whitespace (text, length);
+}
+
+size_t
+scan_symbol (const char *text, size_t length)
+{
+  return SCANNER ()->symbol (text, length);
+}
+
+size_t
+scan_number (const char *text, size_t length)
+{
+  return SCANNER ()->number (text, length);
+}
+
+size_t
+scan_string (const char *text, size_t length)
+{
+  return SCANNER ()->string (text, length);
+}
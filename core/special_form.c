@@ -0,0 +1,42 @@
+#include "core/special_form.h"
+#include "core/symbol_map.h"
+
+static const struct
+{
+  CoreSymbol symbol;
+  SpecialForm form;
+} SPECIAL_FORMS[] = {
+  { CORE_SYMBOL_QUOTE, SPECIAL_QUOTE },
+  { CORE_SYMBOL_QUASIQUOTE, SPECIAL_QUASIQUOTE },
+  { CORE_SYMBOL_IF, SPECIAL_IF },
+  { CORE_SYMBOL_BEGIN, SPECIAL_BEGIN },
+  { CORE_SYMBOL_AND, SPECIAL_AND },
+  { CORE_SYMBOL_OR, SPECIAL_OR },
+  { CORE_SYMBOL_LAMBDA, SPECIAL_LAMBDA },
+  { CORE_SYMBOL_MACRO, SPECIAL_MACRO },
+  { CORE_SYMBOL_DEFINE, SPECIAL_DEFINE },
+  { CORE_SYMBOL_DEFMACRO, SPECIAL_DEFMACRO },
+  { CORE_SYMBOL_SET, SPECIAL_SET },
+  { CORE_SYMBOL_LET, SPECIAL_LET },
+  { CORE_SYMBOL_LET_STAR, SPECIAL_LET_STAR },
+  { CORE_SYMBOL_EVAL, SPECIAL_EVAL },
+  { CORE_SYMBOL_LOAD_FILE, SPECIAL_EVAL },
+  { CORE_SYMBOL_RELOAD_FILE, SPECIAL_EVAL },
+  { CORE_SYMBOL_MACROEXPAND, SPECIAL_RAW },
+  { CORE_SYMBOL_SHOW_META, SPECIAL_RAW },
+  { CORE_SYMBOL_GET_FROM_MODULE, SPECIAL_RAW },
+  { CORE_SYMBOL_LOAD_MODULE, SPECIAL_RAW },
+  { CORE_SYMBOL_RELOAD_MODULE, SPECIAL_RAW },
+  { CORE_SYMBOL_APPLY, SPECIAL_RAW },
+};
+
+SpecialForm
+special_form (Value *symbol)
+{
+  for (size_t i = 0; i < sizeof (SPECIAL_FORMS) / sizeof (SPECIAL_FORMS[0]);
+       i++)
+    if (core_symbols[SPECIAL_FORMS[i].symbol] == symbol)
+      return SPECIAL_FORMS[i].form;
+
+  return SPECIAL_NONE;
+}
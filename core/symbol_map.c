@@ -7,23 +7,28 @@
 #define INITIAL_CAPACITY 2048
 #define LOAD_FACTOR 0.8
 
+// entries keep the symbol's hash so probing can skip most strcmps
 typedef struct
 {
-  const char *key;
-  Value *value;
+  uint32_t hash;
+  Value *symbol;
 } Entry;
 
 static Entry *table = NULL;
 static size_t capacity = 0;
 static size_t size = 0;
 
-static uint32_t
-hash (const char *s)
+static const Meta META_CORE = { .filename = "<builtin>", .line_number = 0 };
+
+Value *core_symbols[CORE_SYMBOL_COUNT];
+
+uint32_t
+symbol_map_hash (const char *s, size_t length)
 {
   uint32_t h = 2166136261u;
-  for (; *s; s++)
+  for (size_t i = 0; i < length; i++)
     {
-      h ^= (unsigned char)*s;
+      h ^= (unsigned char)s[i];
       h *= 16777619u;
     }
   return h;
@@ -44,61 +49,57 @@ resize (size_t new_capacity)
     return;
 
   for (size_t i = 0; i < old_capacity; i++)
-    if (old[i].key)
-      symbol_map_set (old[i].key, old[i].value);
+    if (old[i].symbol)
+      symbol_map_add (old[i].symbol);
 }
 
 void
 symbol_map_init ()
 {
   resize (INITIAL_CAPACITY);
+
+#define X(id, name)                                                           \
+  core_symbols[CORE_SYMBOL_##id] = val_symbol (name, META_CORE);              \
+  core_symbols[CORE_SYMBOL_##id]->flags |= VALUE_FLAG_UNLOCATED;
+  CORE_SYMBOLS (X)
+#undef X
 }
 
 Value *
-symbol_map_get (const char *name)
+symbol_map_get (const char *name, size_t length, uint32_t hash)
 {
   if (size == 0)
     return NULL;
 
-  uint32_t h = hash (name);
-  size_t i = h % capacity;
+  size_t i = hash % capacity;
 
   while (true)
     {
-      if (!table[i].key)
+      if (!table[i].symbol)
         return NULL;
-      if (strcmp (table[i].key, name) == 0)
-        return table[i].value;
+      const char *key = AS_SYMBOL (table[i].symbol)->name;
+      if (table[i].hash == hash && strncmp (key, name, length) == 0
+          && key[length] == '\0')
+        return table[i].symbol;
 
       i = (i + 1) % capacity;
     }
 }
 
+// symbol must not be in the table yet (see val_symbol)
 void
-symbol_map_set (const char *name, Value *value)
+symbol_map_add (Value *symbol)
 {
   if ((double)(size + 1) / capacity > LOAD_FACTOR)
     resize (capacity * 2);
 
-  uint32_t h = hash (name);
-  size_t i = h % capacity;
+  uint32_t hash = AS_SYMBOL (symbol)->hash;
+  size_t i = hash % capacity;
 
-  while (true)
-    {
-      if (!table[i].key)
-        {
-          table[i].key = name;
-          table[i].value = value;
-          size++;
-          return;
-        }
-
-      if (strcmp (table[i].key, name) == 0)
-        {
-          table[i].value = value;
-          return;
-        }
+  while (table[i].symbol)
+    i = (i + 1) % capacity;
 
-      i = (i + 1) % capacity;
-    }
+  table[i].hash = hash;
+  table[i].symbol = symbol;
+  size++;
 }
@@ -1,5 +1,6 @@
 #include "core/value.h"
 #include "core/eval.h"
+#include "core/meta_map.h"
 #include "core/module_map.h"
 #include "core/symbol_map.h"
 
@@ -9,35 +10,23 @@
 
 static Value *GLOBAL_NIL = NULL;
 
-Value *
-val_from_ast (AST *node)
+static Value *
+value_new (ValueType type, size_t size)
 {
-  switch (node->type)
-    {
-    case AST_NIL:
-      return val_nil ();
-    case AST_SYMBOL:
-      return val_symbol (node->as.SYMBOL, node->source_meta);
-    case AST_INTEGER:
-      return val_integer (node->as.INTEGER);
-    case AST_FLOAT:
-      return val_float (node->as.FLOAT);
-    case AST_STRING:
-      return val_string (node->as.STRING);
-    case AST_CONS:
-      {
-        Value *car = val_from_ast (CAR (node));
-        ERROR_OUT (car);
-        Value *cdr = val_from_ast (CDR (node));
-        ERROR_OUT (cdr);
+  Value *node = GC_malloc (size);
+  memset (node, 0, size);
+  node->type = type;
+  return node;
+}
 
-        return val_cons (car, cdr);
-      }
-    case AST_ERROR:
-      return val_error (node->as.ERROR.MESSAGE);
-    default:
-      return val_error ("ERROR: val_from_ast: Unknown ast type");
-    }
+// For values holding no pointers, which the collector need not scan
+static Value *
+value_new_atomic (ValueType type, size_t size)
+{
+  Value *node = GC_malloc_atomic (size);
+  memset (node, 0, size);
+  node->type = type;
+  return node;
 }
 
 Value *
@@ -45,55 +34,74 @@ val_nil (void)
 {
   if (!GLOBAL_NIL)
     {
-      GLOBAL_NIL = GC_malloc (sizeof (Value));
-      memset (GLOBAL_NIL, 0, sizeof (Value));
+      // with room for a cons, so CAR and CDR of nil read as NULL
+      GLOBAL_NIL = GC_malloc (sizeof (ConsValue));
+      memset (GLOBAL_NIL, 0, sizeof (ConsValue));
       GLOBAL_NIL->type = VALUE_NIL;
     }
   return GLOBAL_NIL;
 }
 
+Meta
+value_meta (Value *value)
+{
+  Meta *meta = meta_map_get (value);
+  return meta ? *meta : (Meta){ 0 };
+}
+
 Value *
 val_t (void)
 {
-  return val_symbol ("t", (Meta){ .filename = "#<core>", .line_number = 0 });
+  return CORE_SYMBOL (T);
 }
 
 Value *
 val_integer (long value)
 {
-  Value *node = (Value *)GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_INTEGER;
-  node->as.INTEGER = value;
+  if (value >= FIXNUM_MIN && value <= FIXNUM_MAX)
+    return (Value *)(((uintptr_t)value << 1) | 1);
+
+  Value *node = value_new_atomic (VALUE_INTEGER, sizeof (IntegerValue));
+  AS_INTEGER (node)->value = value;
   return node;
 }
 
 Value *
 val_float (double value)
 {
-  Value *node = (Value *)GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_FLOAT;
-  node->as.FLOAT = value;
+  Value *node = value_new_atomic (VALUE_FLOAT, sizeof (FloatValue));
+  AS_FLOAT (node)->value = value;
   return node;
 }
 
 Value *
 val_string (const char *string)
 {
-  Value *node = (Value *)GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_STRING;
-  node->as.STRING = GC_strdup (string);
+  return val_string_take (GC_strdup (string));
+}
+
+Value *
+val_string_take (char *string)
+{
+  Value *node = value_new (VALUE_STRING, sizeof (StringValue));
+  AS_STRING (node)->value = string;
   return node;
 }
 
 Value *
 val_cons (Value *car, Value *cdr)
 {
-  Value *node = GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_CONS;
+  Value *node = value_new (VALUE_CONS, sizeof (ConsValue));
+  CAR (node) = car;
+  CDR (node) = cdr;
+  return node;
+}
+
+Value *
+val_code (Value *car, Value *cdr)
+{
+  Value *node = value_new (VALUE_CONS, sizeof (CodeValue));
+  node->flags |= VALUE_FLAG_CODE;
   CAR (node) = car;
   CDR (node) = cdr;
   return node;
@@ -102,10 +110,20 @@ val_cons (Value *car, Value *cdr)
 Value *
 val_builtin (Builtin_Function builtin_function)
 {
-  Value *node = (Value *)GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_BUILTIN;
-  node->as.BUILTIN = builtin_function;
+  Value *node = value_new (VALUE_BUILTIN, sizeof (BuiltinValue));
+  AS_BUILTIN (node)->function = builtin_function;
+  return node;
+}
+
+Value *
+val_primitive (const char *name, Primitive_Function function,
+               int min_arguments, int max_arguments)
+{
+  Value *node = value_new (VALUE_PRIMITIVE, sizeof (PrimitiveValue));
+  AS_PRIMITIVE (node)->function = function;
+  AS_PRIMITIVE (node)->name = name;
+  AS_PRIMITIVE (node)->min_arguments = min_arguments;
+  AS_PRIMITIVE (node)->max_arguments = max_arguments;
   return node;
 }
 
@@ -118,33 +136,73 @@ val_module (const char *module_name, Environment *environment)
   if (existing)
       return existing;
 
-  Value *node = (Value *)GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_MODULE;
-  node->as.MODULE.name = (char*)name;
-  node->as.MODULE.environment = environment;
+  Value *node = value_new (VALUE_MODULE, sizeof (ModuleValue));
+  AS_MODULE (node)->name = (char*)name;
+  AS_MODULE (node)->environment = environment;
 
   module_map_set(name, node);
 
   return node;
 }
 
+Value *
+val_local (Value *symbol, int depth, int slot)
+{
+  Value *node = value_new (VALUE_LOCAL, sizeof (LocalValue));
+  AS_LOCAL (node)->symbol = symbol;
+  AS_LOCAL (node)->depth = depth;
+  AS_LOCAL (node)->slot = slot;
+  return node;
+}
+
+Value *
+val_module_reference (Value *module, Value *symbol)
+{
+  Value *node
+      = value_new (VALUE_MODULE_REFERENCE, sizeof (ModuleReferenceValue));
+  AS_MODULE_REFERENCE (node)->module = module;
+  AS_MODULE_REFERENCE (node)->symbol = symbol;
+  AS_MODULE_REFERENCE (node)->version = 0;
+  AS_MODULE_REFERENCE (node)->binding = NULL;
+  return node;
+}
+
 Value *
 val_symbol (const char *symbol, Meta meta)
 {
-  const char *name = GC_strdup (symbol);
+  return val_symbol_slice (symbol, strlen (symbol), meta);
+}
 
-  Value *existing = symbol_map_get (name);
+// The symbol named by the length bytes at name, which need not be followed
+// by a NUL
+Value *
+val_symbol_slice (const char *name, size_t length, Meta meta)
+{
+  uint32_t hash = symbol_map_hash (name, length);
+
+  Value *existing = symbol_map_get (name, length, hash);
   if (existing)
-    return existing;
+    {
+      // core symbols are interned before any source is read, they take the
+      // location of the first place they appear in, like other symbols
+      if (existing->flags & VALUE_FLAG_UNLOCATED && meta.filename)
+        {
+          meta_map_set (existing, meta);
+          existing->flags &= ~VALUE_FLAG_UNLOCATED;
+        }
+      return existing;
+    }
+
+  char *copy = GC_malloc_atomic (length + 1);
+  memcpy (copy, name, length);
+  copy[length] = '\0';
 
-  Value *node = GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  node->type = VALUE_SYMBOL;
-  node->as.SYMBOL = (char *)name;
-  node->meta = meta;
+  Value *node = value_new (VALUE_SYMBOL, sizeof (SymbolValue));
+  AS_SYMBOL (node)->name = copy;
+  AS_SYMBOL (node)->hash = hash;
+  meta_map_set (node, meta);
 
-  symbol_map_set (name, node);
+  symbol_map_add (node);
 
   return node;
 }
@@ -176,17 +234,8 @@ val_error (const char *format, ...)
   vsnprintf (error_msg, length + 1, format, arguments);
   va_end (arguments);
 
-  Value *node = (Value *)GC_malloc (sizeof (Value));
-  memset (node, 0, sizeof (Value));
-  if (!node)
-    {
-      free (error_msg);
-      fprintf (stderr, "INTERNAL-VAL-ERROR: memory allocation failed");
-      exit (1);
-    }
-
-  node->type = VALUE_ERROR;
-  node->as.ERROR.MESSAGE = error_msg;
+  Value *node = value_new (VALUE_ERROR, sizeof (ErrorValue));
+  AS_ERROR (node)->MESSAGE = error_msg;
 
   return node;
 }
@@ -200,24 +249,31 @@ value_print (Value *node)
       return;
     }
 
-  switch (node->type)
+  switch (TYPE (node))
     {
     case VALUE_NIL:
       printf ("nil");
       break;
     case VALUE_SYMBOL:
-      printf ("%s", node->as.SYMBOL);
+      printf ("%s", AS_SYMBOL (node)->name);
+      break;
+    case VALUE_LOCAL:
+      printf ("%s", AS_SYMBOL (AS_LOCAL (node)->symbol)->name);
+      break;
+    case VALUE_MODULE_REFERENCE:
+      printf ("%s/%s", AS_SYMBOL (AS_MODULE_REFERENCE (node)->module)->name,
+              AS_SYMBOL (AS_MODULE_REFERENCE (node)->symbol)->name);
       break;
     case VALUE_INTEGER:
-      printf ("%ld", node->as.INTEGER);
+      printf ("%ld", INTEGER_VALUE (node));
       break;
     case VALUE_FLOAT:
-      printf ("%g", node->as.FLOAT);
+      printf ("%g", AS_FLOAT (node)->value);
       break;
 
     case VALUE_STRING:
       {
-        char *s = node->as.STRING;
+        char *s = AS_STRING (node)->value;
         putchar ('"');
         for (; *s; s++)
           {
@@ -260,16 +316,16 @@ value_print (Value *node)
         printf ("(");
         Value *cur = node;
 
-        while (cur->type == VALUE_CONS)
+        while (TYPE (cur) == VALUE_CONS)
           {
             value_print (CAR (cur));
             cur = CDR (cur);
 
-            if (cur->type == VALUE_CONS)
+            if (TYPE (cur) == VALUE_CONS)
               printf (" ");
           }
 
-        if (cur->type != VALUE_NIL)
+        if (TYPE (cur) != VALUE_NIL)
           {
             printf (" . ");
             value_print (cur);
@@ -279,6 +335,7 @@ value_print (Value *node)
       }
 
     case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
       printf ("#<builtin function>");
       break;
 
@@ -290,14 +347,14 @@ value_print (Value *node)
       break;
 
     case VALUE_ERROR:
-      printf ("%s", node->as.ERROR.MESSAGE);
+      printf ("%s", AS_ERROR (node)->MESSAGE);
       break;
     case VALUE_END_OF_FILE:
       printf ("#<EOF>");
       break;
 
     default:
-      printf ("value: #<UNKNOWN:%d>", node->type);
+      printf ("value: #<UNKNOWN:%d>", TYPE (node));
       break;
     }
 }
@@ -104,24 +104,33 @@ value_to_string_recursive (Value *node, char **buffer, size_t *capacity,
       return;
     }
 
-  switch (node->type)
+  switch (TYPE (node))
     {
     case VALUE_NIL:
       append_string (buffer, capacity, length, "nil");
       break;
     case VALUE_SYMBOL:
-      append_string (buffer, capacity, length, "%s", node->as.SYMBOL);
+      append_string (buffer, capacity, length, "%s", AS_SYMBOL (node)->name);
+      break;
+    case VALUE_LOCAL:
+      append_string (buffer, capacity, length, "%s",
+                     AS_SYMBOL (AS_LOCAL (node)->symbol)->name);
+      break;
+    case VALUE_MODULE_REFERENCE:
+      append_string (buffer, capacity, length, "%s/%s",
+                     AS_SYMBOL (AS_MODULE_REFERENCE (node)->module)->name,
+                     AS_SYMBOL (AS_MODULE_REFERENCE (node)->symbol)->name);
       break;
     case VALUE_INTEGER:
-      append_string (buffer, capacity, length, "%ld", node->as.INTEGER);
+      append_string (buffer, capacity, length, "%ld", INTEGER_VALUE (node));
       break;
     case VALUE_FLOAT:
-      append_string (buffer, capacity, length, "%g", node->as.FLOAT);
+      append_string (buffer, capacity, length, "%g", AS_FLOAT (node)->value);
       break;
 
     case VALUE_STRING:
       {
-        char *escaped = escape_string (node->as.STRING);
+        char *escaped = escape_string (AS_STRING (node)->value);
         if (escaped)
           {
             append_string (buffer, capacity, length, "%s", escaped);
@@ -135,16 +144,16 @@ value_to_string_recursive (Value *node, char **buffer, size_t *capacity,
         append_string (buffer, capacity, length, "(");
         Value *cur = node;
 
-        while (cur->type == VALUE_CONS)
+        while (TYPE (cur) == VALUE_CONS)
           {
             value_to_string_recursive (CAR (cur), buffer, capacity, length);
             cur = CDR (cur);
 
-            if (cur->type == VALUE_CONS)
+            if (TYPE (cur) == VALUE_CONS)
               append_string (buffer, capacity, length, " ");
           }
 
-        if (cur->type != VALUE_NIL)
+        if (TYPE (cur) != VALUE_NIL)
           {
             append_string (buffer, capacity, length, " . ");
             value_to_string_recursive (cur, buffer, capacity, length);
@@ -154,18 +163,19 @@ value_to_string_recursive (Value *node, char **buffer, size_t *capacity,
       }
 
     case VALUE_BUILTIN:
+    case VALUE_PRIMITIVE:
       append_string (buffer, capacity, length, "#<builtin function>");
       break;
 
     case VALUE_ERROR:
-      append_string (buffer, capacity, length, "%s", node->as.ERROR.MESSAGE);
+      append_string (buffer, capacity, length, "%s", AS_ERROR (node)->MESSAGE);
       break;
     case VALUE_END_OF_FILE:
       append_string (buffer, capacity, length, "#<EOF>");
       break;
 
     default:
-      append_string (buffer, capacity, length, "#<UNKNOWN:%d>", node->type);
+      append_string (buffer, capacity, length, "#<UNKNOWN:%d>", TYPE (node));
       break;
     }
 }
@@ -0,0 +1,381 @@
+#include "core/vm.h"
+#include "core/compiler.h"
+#include "core/eval.h"
+#include "core/special_form.h"
+
+#include <gc/gc.h>
+#include <stdbool.h>
+
+typedef struct
+{
+  Chunk *chunk;
+  uint8_t *ip;
+  Environment *environment;
+  size_t base; // stack index the result goes to, where the callee was
+} CallFrame;
+
+typedef struct
+{
+  Value **stack;
+  size_t stack_size;
+  size_t stack_capacity;
+
+  CallFrame *frames;
+  size_t frames_size;
+  size_t frames_capacity;
+} VM;
+
+static void
+push (VM *vm, Value *value)
+{
+  if (vm->stack_size == vm->stack_capacity)
+    {
+      size_t capacity = vm->stack_capacity * 2;
+      Value **stack = GC_malloc (capacity * sizeof (Value *));
+      memcpy (stack, vm->stack, vm->stack_size * sizeof (Value *));
+
+      vm->stack = stack;
+      vm->stack_capacity = capacity;
+    }
+
+  vm->stack[vm->stack_size++] = value;
+}
+
+static Value *
+pop (VM *vm)
+{
+  return vm->stack[--vm->stack_size];
+}
+
+static CallFrame *
+push_frame (VM *vm, Chunk *chunk, Environment *environment, size_t base)
+{
+  if (vm->frames_size == vm->frames_capacity)
+    {
+      size_t capacity = vm->frames_capacity * 2;
+      CallFrame *frames = GC_malloc (capacity * sizeof (CallFrame));
+      memcpy (frames, vm->frames, vm->frames_size * sizeof (CallFrame));
+
+      vm->frames = frames;
+      vm->frames_capacity = capacity;
+    }
+
+  CallFrame *frame = &vm->frames[vm->frames_size++];
+  frame->chunk = chunk;
+  frame->ip = chunk->code;
+  frame->environment = environment;
+  frame->base = base;
+  return frame;
+}
+
+// Set up a call of a closure: NULL once *frame is ready, or the error value
+// the call evaluates to. *frame is set either way, NULL if there is none.
+static Value *
+enter_closure (Value *function, Value **arguments, size_t argc,
+               Environment **frame)
+{
+  *frame = NULL;
+
+  Compiled *compiled = closure_compiled (function);
+  if (!compiled->chunk)
+    {
+      Value *error = NULL;
+      compiled->chunk = compile_closure (function, &error);
+      if (!compiled->chunk)
+        return error;
+    }
+
+  *frame = env_init_frame (AS_CLOSURE (function)->environment,
+                           compiled->frame_size);
+
+  Value *err = bind_values (*frame, AS_CLOSURE (function)->parameters,
+                            arguments, argc);
+  ERROR_OUT (err);
+
+  return NULL;
+}
+
+#define READ_OPERAND() (ip += 2, (size_t)ip[-2] | (size_t)ip[-1] << 8)
+
+static Value *
+run (VM *vm)
+{
+  CallFrame *frame = &vm->frames[vm->frames_size - 1];
+  Chunk *chunk = frame->chunk;
+  uint8_t *ip = frame->ip;
+  Environment *environment = frame->environment;
+  Value *result;
+
+  while (true)
+    switch (*ip++)
+      {
+      case OP_CONSTANT:
+        push (vm, chunk->constants[READ_OPERAND ()]);
+        break;
+
+      case OP_NIL:
+        push (vm, val_nil ());
+        break;
+
+      case OP_POP:
+        vm->stack_size--;
+        break;
+
+      case OP_LOCAL:
+        {
+          size_t depth = READ_OPERAND ();
+          size_t slot = READ_OPERAND ();
+          Value *symbol = chunk->constants[READ_OPERAND ()];
+
+          Environment *scope = environment;
+          for (; depth > 0 && scope; depth--)
+            scope = scope->parent;
+
+          if (scope && slot < scope->bindings_size
+              && scope->bindings[slot].key == symbol)
+            push (vm, scope->bindings[slot].value);
+          else
+            push (vm, env_get (environment, symbol));
+          break;
+        }
+
+      case OP_NAME:
+        push (vm, env_get (environment, chunk->constants[READ_OPERAND ()]));
+        break;
+
+      case OP_GLOBAL:
+        {
+          Value *symbol = chunk->constants[READ_OPERAND ()];
+          CallSite *site = &chunk->caches[READ_OPERAND ()];
+          push (vm, call_site_lookup (site, environment, symbol));
+          break;
+        }
+
+      case OP_MODULE:
+        push (vm, module_reference_get (environment,
+                                        chunk->constants[READ_OPERAND ()]));
+        break;
+
+      case OP_OPERATOR:
+        {
+          Value *symbol = chunk->constants[READ_OPERAND ()];
+          CallSite *site = &chunk->caches[READ_OPERAND ()];
+          Value *form = chunk->constants[READ_OPERAND ()];
+          size_t skip = READ_OPERAND ();
+
+          Value *function = call_site_lookup (site, environment, symbol);
+          if (TYPE (function) == VALUE_MACRO)
+            {
+              // defined after this code was compiled
+              function = evaluate_expression (environment, form);
+              ip = chunk->code + skip;
+            }
+          else if (TYPE (function) == VALUE_ERROR)
+            ip = chunk->code + skip;
+
+          push (vm, function);
+          break;
+        }
+
+      case OP_DEFINE:
+        {
+          Value *symbol = chunk->constants[READ_OPERAND ()];
+          size_t target = READ_OPERAND ();
+
+          if (env_is_defined (environment, symbol))
+            {
+              push (vm, val_error ("define: symbol already defined: %s",
+                                   AS_SYMBOL (symbol)->name));
+              ip = chunk->code + target;
+            }
+          else
+            env_set (environment, symbol, val_nil (), value_meta (symbol));
+          break;
+        }
+
+      case OP_BIND:
+        {
+          Value *symbol = chunk->constants[READ_OPERAND ()];
+          env_set (environment, symbol, pop (vm), value_meta (symbol));
+          break;
+        }
+
+      case OP_SET:
+        {
+          Value *symbol = chunk->constants[READ_OPERAND ()];
+          Value *value = pop (vm);
+
+          if (!env_get_binding (environment, symbol))
+            push (vm, val_error ("set!: cannot set! undefined symbol"));
+          else
+            {
+              env_update (environment, symbol, value, value_meta (symbol));
+              push (vm, symbol);
+            }
+          break;
+        }
+
+      case OP_CHECK:
+        {
+          size_t target = READ_OPERAND ();
+          if (TYPE (vm->stack[vm->stack_size - 1]) == VALUE_ERROR)
+            ip = chunk->code + target;
+          break;
+        }
+
+      case OP_JUMP:
+        ip = chunk->code + READ_OPERAND ();
+        break;
+
+      case OP_JUMP_IF_NIL:
+        {
+          size_t target = READ_OPERAND ();
+          Value *condition = pop (vm);
+          if (IS_NULL (condition))
+            ip = chunk->code + target;
+          break;
+        }
+
+      case OP_AND:
+      case OP_OR:
+        {
+          bool decided = ip[-1] == OP_AND
+                             ? IS_NULL (vm->stack[vm->stack_size - 1])
+                             : !IS_NULL (vm->stack[vm->stack_size - 1]);
+          size_t target = READ_OPERAND ();
+
+          if (decided)
+            ip = chunk->code + target;
+          else
+            vm->stack_size--;
+          break;
+        }
+
+      case OP_CLOSURE:
+        {
+          Value *closure = GC_malloc (sizeof (ClosureValue));
+          *AS_CLOSURE (closure)
+              = *AS_CLOSURE (chunk->constants[READ_OPERAND ()]);
+          AS_CLOSURE (closure)->environment = environment;
+          push (vm, closure);
+          break;
+        }
+
+      case OP_EVAL:
+        push (vm, evaluate_expression (environment,
+                                       chunk->constants[READ_OPERAND ()]));
+        break;
+
+      case OP_CALL:
+      case OP_TAIL_CALL:
+        {
+          bool tail = ip[-1] == OP_TAIL_CALL;
+          size_t argc = READ_OPERAND ();
+          size_t callee = vm->stack_size - argc - 1;
+          Value *function = vm->stack[callee];
+          Value **arguments = &vm->stack[callee + 1];
+
+          if (TYPE (function) == VALUE_LAMBDA)
+            {
+              Environment *callee_environment;
+              result = enter_closure (function, arguments, argc,
+                                      &callee_environment);
+              if (!result)
+                {
+                  Chunk *code = AS_CLOSURE (function)->compiled->chunk;
+                  if (tail)
+                    {
+                      frame->chunk = code;
+                      frame->environment = callee_environment;
+                    }
+                  else
+                    {
+                      frame->ip = ip;
+                      frame = push_frame (vm, code, callee_environment,
+                                          callee);
+                    }
+
+                  vm->stack_size = frame->base;
+                  chunk = code;
+                  ip = code->code;
+                  environment = callee_environment;
+                  break;
+                }
+            }
+          else if (TYPE (function) == VALUE_PRIMITIVE)
+            result = call_primitive (function, arguments, argc);
+          else if (TYPE (function) == VALUE_BUILTIN)
+            result = call_builtin (environment, function, arguments, argc);
+          else if (TYPE (function) == VALUE_ERROR)
+            result = function;
+          else
+            result = val_error ("attempt to call non-function");
+
+          vm->stack_size = callee;
+          if (tail)
+            goto return_result;
+
+          push (vm, result);
+          break;
+        }
+
+      case OP_RETURN:
+        result = pop (vm);
+
+      return_result:
+        vm->stack_size = frame->base;
+        if (--vm->frames_size == 0)
+          return result;
+
+        frame = &vm->frames[vm->frames_size - 1];
+        chunk = frame->chunk;
+        ip = frame->ip;
+        environment = frame->environment;
+
+        push (vm, result);
+        break;
+
+      default:
+        return val_error ("vm: unknown instruction %d", ip[-1]);
+      }
+}
+
+static Value *
+vm_run (Chunk *chunk, Environment *environment)
+{
+  VM vm = { 0 };
+
+  vm.stack_capacity = 256;
+  vm.stack = GC_malloc (vm.stack_capacity * sizeof (Value *));
+
+  vm.frames_capacity = 64;
+  vm.frames = GC_malloc (vm.frames_capacity * sizeof (CallFrame));
+
+  push_frame (&vm, chunk, environment, 0);
+  return run (&vm);
+}
+
+Value *
+vm_evaluate (Environment *environment, Value *expression)
+{
+  if (TYPE (expression) == VALUE_CONS
+      && special_form (CAR (expression)) == SPECIAL_BEGIN)
+    {
+      Value *result = val_nil ();
+      for (Value *forms = CDR (expression); TYPE (forms) == VALUE_CONS;
+           forms = CDR (forms))
+        {
+          result = vm_evaluate (environment, CAR (forms));
+          ERROR_OUT (result);
+        }
+
+      return result;
+    }
+
+  Value *error = NULL;
+  Chunk *chunk = compile_expression (environment, expression, &error);
+  if (!chunk)
+    return error;
+
+  return vm_run (chunk, environment);
+}
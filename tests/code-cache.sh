@@ -0,0 +1,68 @@
+#!/bin/sh
+# Load a file through its .odec code cache and check it reads back as the
+# source does, that the cache is what the next load uses while the source has
+# the same size and time, and that it is read again once the source changes
+odeus="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+cat > shapes.ode <<'EOF'
+(define (square x) (* x x))
+EOF
+cat > main.ode <<'EOF'
+(load-file "lib.ode")
+(display (list a (twice (+ 1 2)) (area 2) data "s\"tr" -7 2.5 'sym))
+(display "\n")
+EOF
+lib='(defmacro (twice e) `(list ,e ,e))
+(define (area r) (* 3 (shapes/square r)))
+(define data (quote (1 (2 . 3) "x" nil)))
+(define a %s)
+'
+
+status=0
+check ()
+{
+  if [ "$output" != "$1" ]; then
+    echo "odeus $flags: $2: expected"
+    echo "$1"
+    echo "got"
+    echo "$output"
+    status=1
+  fi
+}
+
+for flags in "" --vm --nodes; do
+  rm -f ./*.odec
+  printf "$lib" 1 > lib.ode
+  expected=$("$odeus" --no-code-cache $flags main.ode 2>&1)
+
+  output=$("$odeus" $flags main.ode 2>&1)
+  check "$expected" "first load"
+  if [ ! -f lib.odec ] || [ ! -f shapes.odec ]; then
+    echo "odeus $flags: no code cache written"
+    status=1
+  fi
+
+  output=$("$odeus" $flags main.ode 2>&1)
+  check "$expected" "load from the cache"
+
+  # same size and time: the cache is trusted without reading the source
+  touch -r lib.ode stamp
+  printf "$lib" 2 > lib.ode
+  touch -r stamp lib.ode
+  output=$("$odeus" $flags main.ode 2>&1)
+  check "$expected" "cache of a file with the same size and time"
+
+  # another time: the source is hashed and read again as it changed
+  touch -d '1 minute ago' lib.ode
+  output=$("$odeus" $flags main.ode 2>&1)
+  check "$(echo "$expected" | sed 's/^(1 /(2 /')" "changed source"
+
+  # another size
+  printf "$lib" 300 > lib.ode
+  output=$("$odeus" $flags main.ode 2>&1)
+  check "$(echo "$expected" | sed 's/^(1 /(300 /')" "resized source"
+done
+exit $status
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Run a program under every evaluator and compare what it prints with the
+# .out file next to it
+odeus="$1"
+program="$2"
+expected=$(cat "${program%.ode}.out")
+cd "$(dirname "$program")" || exit 1
+program=$(basename "$program")
+
+status=0
+for flags in "" --vm --nodes; do
+  output=$("$odeus" --no-code-cache $flags "$program" 2>&1)
+  if [ "$output" != "$expected" ]; then
+    echo "odeus $flags $program: expected"
+    echo "$expected"
+    echo "got"
+    echo "$output"
+    status=1
+  fi
+done
+exit $status
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Save a heap image after loading a library, start from it, save it again
+# from there and start from that: programs see the same library every time,
+# closures, macros and loaded modules included
+odeus="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+cat > shapes.ode <<'EOF'
+(define (square x) (* x x))
+EOF
+cat > lib.ode <<'EOF'
+(defmacro (twice e) `(list ,e ,e))
+(define (adder x) (lambda (y) (+ x y)))
+(define add10 (adder 10))
+(define (area r) (* 3 (shapes/square r)))
+(define data (quote (1 (2 . 3) "x" 2.5)))
+(load-module shapes)
+; called once, so the image is saved with what the evaluators cached
+(area 1)
+EOF
+cat > main.ode <<'EOF'
+(display (list (twice 1) (add10 5) (area 2) (shapes/square 4) data
+               (map (adder 1) (list 1 2))))
+(display "\n")
+EOF
+expected='((1 1) 15 12 16 (1 (2 . 3) x 2.5) (2 3))'
+
+status=0
+check ()
+{
+  output=$("$odeus" --no-code-cache $flags "$@" main.ode 2>&1)
+  if [ "$output" != "$expected" ]; then
+    echo "odeus $flags $*: expected"
+    echo "$expected"
+    echo "got"
+    echo "$output"
+    status=1
+  fi
+}
+
+for flags in "" --vm --nodes; do
+  rm -f ./*.img
+  cp shapes.ode module.ode
+  "$odeus" --no-code-cache $flags --dump-image lib.img lib.ode || status=1
+  # the module comes from the image, not from its file
+  rm shapes.ode
+  check --image lib.img
+  "$odeus" --no-code-cache $flags --image lib.img --dump-image again.img \
+    || status=1
+  check --image again.img
+  mv module.ode shapes.ode
+done
+exit $status
@@ -0,0 +1,33 @@
+#!/bin/sh
+# reload-file when the first form of the file is the one that changed:
+# lib.ode is rewritten once the REPL has loaded it, then reloaded
+odeus="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+status=0
+for flags in "" --vm --nodes; do
+  printf '(define a 1)\n(define b 2)\n' > lib.ode
+  : > output
+  {
+    echo '(load-file "lib.ode")'
+    echo '(+ a b)'
+    tries=0
+    until grep -q -- '-> 3' output; do
+      tries=$((tries + 1))
+      [ $tries -gt 100 ] && break
+      sleep 0.1
+    done
+    printf '(define a 10)\n(define b 2)\n' > lib.ode
+    echo '(reload-file "lib.ode")'
+    echo '(+ a b)'
+  } | "$odeus" $flags > output 2>&1
+
+  if ! grep -q -- '-> 12' output; then
+    echo "odeus $flags: the changed first form was not reloaded"
+    cat output
+    status=1
+  fi
+done
+exit $status
@@ -0,0 +1,35 @@
+#!/bin/sh
+# reload-file of a file one of whose forms loads another file into the same
+# environment: what that file defined is its own, and stays when the form
+# that loaded it is dropped
+odeus="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+status=0
+for flags in "" --vm --nodes; do
+  printf '(define y 2)\n' > inner.ode
+  printf '(load-file "inner.ode")\n(define a 1)\n' > lib.ode
+  : > output
+  {
+    echo '(load-file "lib.ode")'
+    echo '(+ a y)'
+    tries=0
+    until grep -q -- '-> 3' output; do
+      tries=$((tries + 1))
+      [ $tries -gt 100 ] && break
+      sleep 0.1
+    done
+    printf '(define a 10)\n' > lib.ode
+    echo '(reload-file "lib.ode")'
+    echo '(+ a y)'
+  } | "$odeus" --no-code-cache $flags > output 2>&1
+
+  if ! grep -q -- '-> 12' output; then
+    echo "odeus $flags: the bindings of the nested load were dropped"
+    cat output
+    status=1
+  fi
+done
+exit $status